@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "misc/FrustumCulling.hpp"
+
+/** Time per box of FrustumCulling::testAABBBatch() against testAABB() called per tile.
+ * usage: culling_bench [boxes] [repeats]
+ * Batch runs both over the whole array and by four boxes, as Layer culls children of a node.
+ * Results of all paths are compared first, the run fails on any difference
+ **/
+
+using namespace KCore;
+
+namespace {
+    struct Boxes {
+        std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+        [[nodiscard]] AABBBatch batch
+                (std::size_t offset, std::size_t count) const {
+            return {minX.data() + offset, minY.data() + offset, minZ.data() + offset,
+                    maxX.data() + offset, maxY.data() + offset, maxZ.data() + offset, count};
+        }
+    };
+
+    uint8_t testScalar
+            (const FrustumCulling &culling, const Boxes &boxes, std::size_t i, uint8_t planeMask) {
+        auto straddles = planeMask;
+        auto state = culling.testAABB(boxes.minX[i], boxes.minY[i], boxes.minZ[i],
+                                      boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i], straddles);
+        return state == Outside ? FrustumCulling::OUTSIDE : straddles;
+    }
+
+    template<typename Pass>
+    double nanosecondsPerBox
+            (std::size_t boxes, int repeats, Pass &&pass) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++) pass();
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::nano>(end - start).count() / ((double) boxes * repeats);
+    }
+}
+
+int main(int argc, char **argv) {
+    // odd count, so the batch tail is measured too
+    auto count = argc > 1 ? (std::size_t) std::atol(argv[1]) : 4099;
+    auto repeats = argc > 2 ? std::atoi(argv[2]) : 2000;
+
+    FrustumCulling culling;
+    culling.updateFrustum(glm::perspective(1.0f, 1.7f, 0.01f, 100.0f),
+                          glm::lookAt(glm::vec3{0.0f, 2.0f, 5.0f}, glm::vec3{0.0f}, glm::vec3{0.0f, 1.0f, 0.0f}));
+
+    // tiles of different size around the camera, less than half of them are visible
+    std::mt19937 random{3};
+    std::uniform_real_distribution<float> position{-20.0f, 20.0f}, size{0.01f, 3.0f};
+
+    Boxes boxes;
+    for (std::size_t i = 0; i < count; i++) {
+        auto x = position(random), z = position(random), half = size(random);
+        boxes.minX.push_back(x - half), boxes.maxX.push_back(x + half);
+        boxes.minY.push_back(-1.0f), boxes.maxY.push_back(1.0f);
+        boxes.minZ.push_back(z - half), boxes.maxZ.push_back(z + half);
+    }
+
+    std::vector<uint8_t> visibility(count), scalar(count), batch(count), grouped(count);
+
+    std::size_t mismatches = 0;
+    for (uint8_t planeMask = 0; planeMask <= FrustumCulling::ALL_PLANES; planeMask++) {
+        culling.testAABBBatch(boxes.batch(0, count), planeMask, batch.data());
+        for (std::size_t i = 0; i < count; i++)
+            mismatches += batch[i] != testScalar(culling, boxes, i, planeMask);
+    }
+
+    std::size_t visible = 0;
+    for (auto result: batch) visible += result != FrustumCulling::OUTSIDE;
+
+    // two-state test of the whole frustum, as tiles were culled before the batch path
+    auto visibilityTime = nanosecondsPerBox(count, repeats, [&]() {
+        for (std::size_t i = 0; i < count; i++)
+            visibility[i] = culling.testAABB(boxes.minX[i], boxes.minY[i], boxes.minZ[i],
+                                             boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+    });
+
+    auto scalarTime = nanosecondsPerBox(count, repeats, [&]() {
+        for (std::size_t i = 0; i < count; i++)
+            scalar[i] = testScalar(culling, boxes, i, FrustumCulling::ALL_PLANES);
+    });
+
+    auto batchTime = nanosecondsPerBox(count, repeats, [&]() {
+        culling.testAABBBatch(boxes.batch(0, count), FrustumCulling::ALL_PLANES, batch.data());
+    });
+
+    auto groupedTime = nanosecondsPerBox(count, repeats, [&]() {
+        for (std::size_t i = 0; i < count; i += 4)
+            culling.testAABBBatch(boxes.batch(i, std::min<std::size_t>(4, count - i)),
+                                  FrustumCulling::ALL_PLANES, grouped.data() + i);
+    });
+
+    for (std::size_t i = 0; i < count; i++)
+        mismatches += (bool) visibility[i] != (batch[i] != FrustumCulling::OUTSIDE);
+    mismatches += scalar != batch;
+    mismatches += grouped != batch;
+
+    std::printf("boxes: %zu, visible: %zu, repeats: %d\n", count, visible, repeats);
+    std::printf("visibility test:   %6.2f ns/box\n", visibilityTime);
+    std::printf("testAABB per tile: %6.2f ns/box\n", scalarTime);
+    std::printf("batch of all:      %6.2f ns/box, speedup %.2fx\n", batchTime, scalarTime / batchTime);
+    std::printf("batch by four:     %6.2f ns/box, speedup %.2fx\n", groupedTime, scalarTime / groupedTime);
+
+    if (mismatches) std::printf("%zu results differ from testAABB\n", mismatches);
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "layer/Layer.hpp"
+
+/** Time of Layer::subdivideSpace() by count of subdivision threads, the first one is serial.
+ * usage: subdivision_bench [target] [threads...]
+ * Camera looks along the ground at low altitude, so the tree is deep and wide. Every layer
+ * goes the same path and has to visit the same nodes, otherwise the run is reported as failed
+ **/
+
+using namespace KCore;
+
+namespace {
+    constexpr int WARMUP_FRAMES = 4;
+    constexpr int MEASURED_FRAMES = 32;
+
+    struct Result {
+        int threads;
+        double milliseconds;
+        uint64_t nodes;
+    };
+}
+
+static Result measure
+        (int threads, float target) {
+    Layer layer{46.95f, 142.73f};
+    layer.setSubdivisionThreads(threads);
+
+    auto projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.0001f, 100000.0f);
+
+    Result result{threads, 0.0, 0};
+    for (int frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++) {
+        auto shift = 0.01f * (float) frame;
+        auto view = glm::lookAt(glm::vec3{shift, 0.05f, 0.0f}, glm::vec3{shift + 1.0f, 0.0f, 0.1f * shift},
+                                glm::vec3{0.0f, 1.0f, 0.0f});
+
+        layer.updateFrustum(projection, view);
+        layer.setPosition(glm::inverse(view)[3]);
+
+        auto visited = layer.getStats().nodesVisited;
+        auto start = std::chrono::steady_clock::now();
+        layer.subdivideSpace(target);
+        auto end = std::chrono::steady_clock::now();
+
+        if (frame < WARMUP_FRAMES) continue;
+        result.milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+        result.nodes += layer.getStats().nodesVisited - visited;
+    }
+
+    result.milliseconds /= MEASURED_FRAMES;
+    return result;
+}
+
+int main(int argc, char **argv) {
+    auto target = argc > 1 ? (float) std::atof(argv[1]) : 0.05f;
+
+    std::vector<int> threads{1};
+    for (int i = 2; i < argc; i++) threads.push_back(std::atoi(argv[i]));
+    if (argc <= 2) {
+        auto hardware = (int) std::max(std::thread::hardware_concurrency(), 1u);
+        for (int count = 2; count <= std::max(hardware, 4); count *= 2) threads.push_back(count);
+    }
+
+    std::printf("hardware threads: %u, target: %.3f\n", std::thread::hardware_concurrency(), target);
+
+    bool mismatch = false;
+    Result serial{};
+    for (auto count: threads) {
+        auto result = measure(count, target);
+        if (count == threads.front()) serial = result;
+        mismatch |= result.nodes != serial.nodes;
+
+        std::printf("threads %2d: %8.3f ms/frame, %8.1f nodes/frame, speedup %.2fx\n",
+                    count, result.milliseconds, (double) result.nodes / MEASURED_FRAMES,
+                    serial.milliseconds / result.milliseconds);
+    }
+
+    if (mismatch) std::printf("visited nodes differ from serial traversal\n");
+    return mismatch ? EXIT_FAILURE : EXIT_SUCCESS;
+}
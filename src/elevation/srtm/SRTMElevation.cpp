@@ -41,10 +41,13 @@ namespace KCore {
 
     std::vector<std::vector<float>> SRTMElevation::getDataForXYZ
             (const glm::ivec3 &tilecode, const glm::ivec2 &slices) {
-        auto minimalX = GeographyConverter::tileToLon(tilecode.x, tilecode.z);
-        auto maximalY = GeographyConverter::tileToLat(tilecode.y, tilecode.z);
-        auto maximalX = GeographyConverter::tileToLon(tilecode.x + 1, tilecode.z);
-        auto minimalY = GeographyConverter::tileToLat(tilecode.y + 1, tilecode.z);
+        // far corner of the last tile at max zoom fits unsigned grid only
+        auto x = (uint32_t) tilecode.x, y = (uint32_t) tilecode.y, z = (uint32_t) tilecode.z;
+
+        auto minimalX = GeographyConverter::tileToLon(x, z);
+        auto maximalY = GeographyConverter::tileToLat(y, z);
+        auto maximalX = GeographyConverter::tileToLon(x + 1, z);
+        auto minimalY = GeographyConverter::tileToLat(y + 1, z);
 
         float offsetX = std::abs(minimalX - maximalX) / (float) slices.x;
         float offsetY = std::abs(maximalY - minimalY) / (float) slices.y;
@@ -9,6 +9,8 @@
 
 #include "glm/glm.hpp"
 
+#include "TileKey.hpp"
+
 namespace KCore {
     class GeographyConverter {
     public:
@@ -61,36 +63,29 @@ namespace KCore {
             return GeographyConverter::unproject(_point);
         }
 
-        static glm::ivec3 quadcodeToTilecode
-                (const std::string &quadcode) {
-            int x = 0, y = 0, z = (int) quadcode.length();
-
-            for (int i = z; i > 0; i--) {
-                auto mask = 1 << (i - 1);
+        // same as latLonToPoint of tile corner (north-west of x, y), but without trigonometry:
+        // web mercator tiles split the projected square evenly, so tile edges are linear in x and y
+        static void tileCornerToPoint
+                (uint32_t x, uint32_t y, int z, double &pointX, double &pointY) {
+            auto tiles = (double) (std::uint64_t{1} << z);
+            auto halfWorld = (double) R * M_PI;
 
-                auto ch = quadcode[z - i];
-                int q = ch - '0';
-
-                if (q == 1)
-                    x |= mask;
-                if (q == 2)
-                    y |= mask;
-                if (q == 3) {
-                    x |= mask;
-                    y |= mask;
-                }
-            }
+            pointX = -MULTIPLIER * halfWorld * (2.0 * x / tiles - 1.0);
+            pointY = -MULTIPLIER * halfWorld * (1.0 - 2.0 * y / tiles);
+        }
 
-            return {x, y, z};
+        static glm::ivec3 quadcodeToTilecode
+                (const std::string &quadcode) {
+            return TileKey::fromQuadcode(quadcode).toTilecode();
         }
 
         static float tileToLon
-                (uint16_t x, uint16_t z) {
+                (uint32_t x, uint32_t z) {
             return (float) x / powf(2.0f, z) * 360.0f - 180.0f;
         }
 
         static float tileToLat
-                (uint16_t y, uint16_t z) {
+                (uint32_t y, uint32_t z) {
             float n = M_PI - 2.0f * M_PI * y / powf(2.0f, z);
             return 180.0f / (float) M_PI * (float) atanf(0.5f * (expf(n) - expf(-n)));
         }
@@ -7,28 +7,21 @@
 
 namespace KCore {
     TileDescription::TileDescription
-            (const Layer *parent, const std::string &quadcode) {
-        if (quadcode.empty()) throw std::invalid_argument("Provided empty quadcode!");
-        setQuadcode(quadcode);
+            (const Layer *parent, TileKey key) {
+        if (key.getZoom() == 0) throw std::invalid_argument("Provided empty tile key!");
+        setKey(key);
 
-        setTilecode(GeographyConverter::quadcodeToTilecode(quadcode));
+        setTilecode(key.toTilecode());
 
         {
+            // world bounds come straight from the tile grid, no lat/lon round trip
             const auto &tilecode = getTilecode();
 
-            auto w = GeographyConverter::tileToLon(tilecode[0], tilecode[2]);
-            auto s = GeographyConverter::tileToLat(tilecode[1] + 1, tilecode[2]);
-            auto e = GeographyConverter::tileToLon(tilecode[0] + 1, tilecode[2]);
-            auto n = GeographyConverter::tileToLat(tilecode[1], tilecode[2]);
+            // far corner of the last tile at max zoom is 2^31, it fits unsigned grid only
+            auto x = (uint32_t) tilecode[0], y = (uint32_t) tilecode[1];
 
-            setBoundsLatLon({w, s, e, n});
-        }
-
-        {
-            const auto &boundsLatLon = getBoundsLatLon();
-
-            auto sw = parent->latLonToWorldPosition({boundsLatLon[1], boundsLatLon[0]});
-            auto ne = parent->latLonToWorldPosition({boundsLatLon[3], boundsLatLon[2]});
+            auto sw = parent->tileCornerToWorldPosition(x, y + 1, tilecode[2]);
+            auto ne = parent->tileCornerToWorldPosition(x + 1, y, tilecode[2]);
 
             setBoundsWorld({sw.x, sw.y, ne.x, ne.y});
         }
@@ -41,6 +34,8 @@ namespace KCore {
             setCenter({x, y});
             setScale(boundsWorld[1] - boundsWorld[3]);
         }
+
+        setHeightRange(parent->sampleHeightRange(*this));
     }
 
     std::string TileDescription::createTileURL() const {
@@ -51,9 +46,9 @@ namespace KCore {
         return strstream.str();
     }
 
-    void TileDescription::setQuadcode
-            (const std::string &quadcode) {
-        TileDescription::mQuadcode = quadcode;
+    void TileDescription::setKey
+            (TileKey key) {
+        TileDescription::mKey = key;
     }
 
     void TileDescription::setTilecode
@@ -61,11 +56,6 @@ namespace KCore {
         TileDescription::mTilecode = tilecode;
     }
 
-    void TileDescription::setBoundsLatLon
-            (const glm::vec4 &boundsLatLon) {
-        TileDescription::mBoundsLatLon = boundsLatLon;
-    }
-
     void TileDescription::setBoundsWorld
             (const glm::vec4 &boundsWorld) {
         TileDescription::mBoundsWorld = boundsWorld;
@@ -76,6 +66,11 @@ namespace KCore {
         TileDescription::mCenter = center;
     }
 
+    void TileDescription::setHeightRange
+            (const glm::vec2 &heightRange) {
+        TileDescription::mHeightRange = heightRange;
+    }
+
     void TileDescription::setScale
             (const float &scale) {
         TileDescription::mScale = scale;
@@ -91,16 +86,28 @@ namespace KCore {
         TileDescription::mVisibility = visibility;
     }
 
-    const std::string &TileDescription::getQuadcode() const {
-        return mQuadcode;
+    TileKey TileDescription::getKey() const {
+        return mKey;
+    }
+
+    std::string TileDescription::getQuadcode() const {
+        return mKey.toQuadcode();
     }
 
     const glm::ivec3 &TileDescription::getTilecode() const {
         return mTilecode;
     }
 
-    const glm::vec4 &TileDescription::getBoundsLatLon() const {
-        return mBoundsLatLon;
+    glm::vec4 TileDescription::getBoundsLatLon() const {
+        // same unsigned grid as the world bounds, far corner at max zoom doesn't fit int
+        auto x = (uint32_t) mTilecode[0], y = (uint32_t) mTilecode[1], z = (uint32_t) mTilecode[2];
+
+        auto w = GeographyConverter::tileToLon(x, z);
+        auto s = GeographyConverter::tileToLat(y + 1, z);
+        auto e = GeographyConverter::tileToLon(x + 1, z);
+        auto n = GeographyConverter::tileToLat(y, z);
+
+        return {w, s, e, n};
     }
 
     const glm::vec4 &TileDescription::getBoundsWorld() const {
@@ -111,6 +118,10 @@ namespace KCore {
         return mCenter;
     }
 
+    const glm::vec2 &TileDescription::getHeightRange() const {
+        return mHeightRange;
+    }
+
     float TileDescription::getScale() const {
         return mScale;
     }
@@ -10,6 +10,7 @@
 #include "glm/glm.hpp"
 
 #include "GeographyConverter.hpp"
+#include "TileKey.hpp"
 
 namespace KCore {
     class Layer;
@@ -29,12 +30,13 @@ namespace KCore {
 
     class TileDescription {
     private:
-        std::string mQuadcode;
+        TileKey mKey{};
 
         glm::ivec3 mTilecode{};
-        glm::vec4 mBoundsLatLon{};
         glm::vec4 mBoundsWorld{};
         glm::vec2 mCenter{};
+        // lowest and highest terrain point in world units
+        glm::vec2 mHeightRange{};
 
         TileType mType = Leaf;
         TileVisibility mVisibility = Visible;
@@ -45,25 +47,25 @@ namespace KCore {
         TileDescription() = default;
 
         TileDescription
-                (const Layer *parent, const std::string &quadcode);
+                (const Layer *parent, TileKey key);
 
         ~TileDescription() = default;
 
-        void setQuadcode
-                (const std::string &quadcode);
+        void setKey
+                (TileKey key);
 
         void setTilecode
                 (const glm::ivec3 &tilecode);
 
-        void setBoundsLatLon
-                (const glm::vec4 &boundsLatLon);
-
         void setBoundsWorld
                 (const glm::vec4 &boundsWorld);
 
         void setCenter
                 (const glm::vec2 &center);
 
+        void setHeightRange
+                (const glm::vec2 &heightRange);
+
         void setVisibility
                 (const TileVisibility &visibility);
 
@@ -73,16 +75,21 @@ namespace KCore {
         void setType
                 (const TileType &type);
 
-        [[nodiscard]] const std::string &getQuadcode() const;
+        [[nodiscard]] TileKey getKey() const;
+
+        [[nodiscard]] std::string getQuadcode() const;
 
         [[nodiscard]] const glm::ivec3 &getTilecode() const;
 
-        [[nodiscard]] const glm::vec4 &getBoundsLatLon() const;
+        // computed on demand, it's not needed on the subdivision path
+        [[nodiscard]] glm::vec4 getBoundsLatLon() const;
 
         [[nodiscard]] const glm::vec4 &getBoundsWorld() const;
 
         [[nodiscard]] const glm::vec2 &getCenter() const;
 
+        [[nodiscard]] const glm::vec2 &getHeightRange() const;
+
         [[nodiscard]] TileVisibility getVisibility() const;
 
         [[nodiscard]] float getScale() const;
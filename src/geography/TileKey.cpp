@@ -0,0 +1,39 @@
+#include "TileKey.hpp"
+
+namespace KCore {
+    std::string TileKey::toQuadcode() const {
+        char quadcode[MAX_ZOOM + 1];
+        writeQuadcode(quadcode, sizeof(quadcode));
+        return quadcode;
+    }
+
+    int TileKey::writeQuadcode
+            (char *quadcode, int capacity) const {
+        auto zoom = getZoom();
+        if (zoom + 1 > capacity) return -1;
+
+        for (int i = 0; i < zoom; i++)
+            quadcode[i] = char('0' + ((value >> (2 * (zoom - i - 1))) & 3));
+        quadcode[zoom] = '\0';
+
+        return zoom;
+    }
+
+    DllExport int TileKeyToQuadcode
+            (std::uint64_t key, char *quadcode_ptr, int capacity) {
+        return TileKey{key}.writeQuadcode(quadcode_ptr, capacity);
+    }
+
+    DllExport void TileKeyToTilecode
+            (std::uint64_t key, int &x, int &y, int &z) {
+        auto tilecode = TileKey{key}.toTilecode();
+        x = tilecode.x;
+        y = tilecode.y;
+        z = tilecode.z;
+    }
+
+    DllExport std::uint64_t QuadcodeToTileKey
+            (const char *quadcode) {
+        return TileKey::fromQuadcode(quadcode).value;
+    }
+}
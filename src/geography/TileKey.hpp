@@ -0,0 +1,140 @@
+#pragma once
+
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "glm/glm.hpp"
+
+#include "../misc/Bindings.hpp"
+
+namespace KCore {
+    /** Packed tile identity: a leading sentinel bit followed by two bits per zoom level
+     * (the quadcode digits, most significant level first). Digit bit 0 is x, bit 1 is y,
+     * so "0132" and the key 0b1'00'01'11'10 describe the same tile.
+     **/
+    struct TileKey {
+        constexpr static int MAX_ZOOM = 31;
+
+        std::uint64_t value{0};
+
+        constexpr TileKey() = default;
+
+        constexpr explicit TileKey
+                (std::uint64_t value) : value(value) {}
+
+        [[nodiscard]] constexpr static TileKey root() {
+            return TileKey{1};
+        }
+
+        [[nodiscard]] static TileKey fromQuadcode
+                (std::string_view quadcode) {
+            auto key = root();
+            for (const auto &ch: quadcode) key = key.child(ch - '0');
+            return key;
+        }
+
+        [[nodiscard]] static TileKey fromTilecode
+                (const glm::ivec3 &tilecode) {
+            auto z = (std::uint32_t) tilecode.z;
+            return TileKey{(std::uint64_t{1} << (2 * z)) |
+                           spreadBits((std::uint32_t) tilecode.x) |
+                           (spreadBits((std::uint32_t) tilecode.y) << 1)};
+        }
+
+        [[nodiscard]] constexpr bool isValid() const {
+            return value != 0;
+        }
+
+        [[nodiscard]] constexpr int getZoom() const {
+            return (std::bit_width(value) - 1) / 2;
+        }
+
+        [[nodiscard]] constexpr int getQuadrant() const {
+            return (int) (value & 3);
+        }
+
+        [[nodiscard]] constexpr TileKey parent() const {
+            return TileKey{value >> 2};
+        }
+
+        [[nodiscard]] constexpr TileKey child
+                (int quadrant) const {
+            return TileKey{(value << 2) | (std::uint64_t) quadrant};
+        }
+
+        [[nodiscard]] glm::ivec3 toTilecode() const {
+            auto code = value & ~(std::uint64_t{1} << (2 * getZoom()));
+            return {(int) compactBits(code), (int) compactBits(code >> 1), getZoom()};
+        }
+
+        [[nodiscard]] std::string toQuadcode() const;
+
+        // writes zero-terminated quadcode, returns its length or -1 if it doesn't fit
+        int writeQuadcode
+                (char *quadcode, int capacity) const;
+
+        constexpr auto operator<=>(const TileKey &) const = default;
+
+        // order of depth-first (pre-order) traversal: parent goes first, then children 0..3
+        [[nodiscard]] constexpr static bool traversalLess
+                (TileKey lhs, TileKey rhs) {
+            auto lhsPath = lhs.alignedPath(), rhsPath = rhs.alignedPath();
+            if (lhsPath != rhsPath) return lhsPath < rhsPath;
+            return lhs.getZoom() < rhs.getZoom();
+        }
+
+    private:
+        // quadcode digits without sentinel, padded up to the deepest zoom
+        [[nodiscard]] constexpr std::uint64_t alignedPath() const {
+            auto zoom = getZoom();
+            return (value ^ (std::uint64_t{1} << (2 * zoom))) << (2 * (MAX_ZOOM - zoom));
+        }
+
+        constexpr static std::uint64_t spreadBits
+                (std::uint32_t v) {
+            std::uint64_t x = v;
+            x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+            x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+            x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+            x = (x | (x << 2)) & 0x3333333333333333ull;
+            x = (x | (x << 1)) & 0x5555555555555555ull;
+            return x;
+        }
+
+        constexpr static std::uint32_t compactBits
+                (std::uint64_t x) {
+            x &= 0x5555555555555555ull;
+            x = (x | (x >> 1)) & 0x3333333333333333ull;
+            x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+            x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+            x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+            x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+            return (std::uint32_t) x;
+        }
+    };
+
+    extern "C" {
+    DllExport int TileKeyToQuadcode
+            (std::uint64_t key, char *quadcode_ptr, int capacity);
+    DllExport void TileKeyToTilecode
+            (std::uint64_t key, int &x, int &y, int &z);
+    DllExport std::uint64_t QuadcodeToTileKey
+            (const char *quadcode);
+    }
+}
+
+template<>
+struct std::hash<KCore::TileKey> {
+    std::size_t operator()(const KCore::TileKey &key) const noexcept {
+        // keys are dense in the low bits, mix them so buckets don't cluster
+        auto x = key.value;
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        return (std::size_t) x;
+    }
+};
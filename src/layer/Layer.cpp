@@ -1,9 +1,23 @@
 #include "Layer.hpp"
 
-#include "../misc/Utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
 #include "../network/HTTPRequestAdapter/HTTPRequestNetworkAdapter.hpp"
 
 namespace KCore {
+    namespace {
+        // heap order of refinement: the greatest error on top, ties broken by key to stay deterministic
+        bool refinementOrder
+                (const RefinementCandidate &lhs, const RefinementCandidate &rhs) {
+            if (lhs.error != rhs.error) return lhs.error < rhs.error;
+            return lhs.node->description.getKey() > rhs.node->description.getKey();
+        }
+    }
+
     Layer::Layer() : Layer(0.0f, 0.0f) {}
 
     Layer::Layer
@@ -11,14 +25,61 @@ namespace KCore {
         mOriginLatLon = GeographyConverter::latLonToPoint({latitude, longitude});
         mOriginPosition = {latitude, 0.0f, longitude};
 
-        mNetworkAdapter = new HTTPRequestNetworkAdapter();
+        mNetworkAdapter = std::make_unique<HTTPRequestNetworkAdapter>();
+        mRequested.reserve(REQUESTS_RESERVE);
+        mPendingRequests.reserve(REQUESTS_RESERVE);
 
         // set defaults
         setRasterUrl("http://tile.openstreetmap.org/{z}/{x}/{y}.png");
     }
 
+    Layer::~Layer() {
+        // requests capture the layer, none of them runs after shutdown
+        mShuttingDown.store(true);
+        notifyImageEventsFreed();
+        mNetworkAdapter->shutdown();
+        setEventDeliveryThread(false);
+
+        // pixels of images the host never took
+        PendingImage image;
+        while (mImageEvents.tryPop(image))
+            STBImageUtils::releaseImageBuffer(image.event.payload.image.data);
+    }
+
     void Layer::update() {
+        // camera stays in place: node errors are still valid, only the frustum is checked again
+        if (mCalculatedGeneration == mPositionGeneration) mStats.framesRevalidated++;
+
+        mStats.framesCalculated++;
+        mFrameTime = std::chrono::steady_clock::now();
+        mStats.nodesVisited = 0;
+        mStats.refinementsDeferred = 0;
+        mStats.tilesCapped = 0;
+        mStats.tilesPrefetched = 0;
+        mTransitionsHeld.store(0, std::memory_order_relaxed);
+        mConfigChanged = false;
+
         calculateTiles();
+        mCalculatedGeneration = mPositionGeneration;
+
+        mStats.visibleTiles = mCurrTiles.size();
+        mStats.transitionsHeld = mTransitionsHeld.load(std::memory_order_relaxed);
+    }
+
+    void Layer::skipFrame() {
+        mStats.framesSkipped++;
+
+        // tiles are the same, but spilled events and pending requests still have to go out
+        if (flushCoreEventsSpill() > 0) notifyDelivery();
+        scheduleRequests();
+    }
+
+    const LayerStats &Layer::getStats() const {
+        return mStats;
+    }
+
+    bool Layer::isConfigChanged() const {
+        return mConfigChanged;
     }
 
     glm::vec2 Layer::latLonToWorldPosition
@@ -27,6 +88,15 @@ namespace KCore {
         return projectedPoint - mOriginLatLon;
     }
 
+    glm::vec2 Layer::tileCornerToWorldPosition
+            (uint32_t x, uint32_t y, int z) const {
+        double pointX, pointY;
+        GeographyConverter::tileCornerToPoint(x, y, z, pointX, pointY);
+
+        // subtracted in double, deep tiles are much smaller than float precision of far coordinates
+        return {(float) (pointX - mOriginLatLon.x), (float) (pointY - mOriginLatLon.y)};
+    }
+
     glm::vec2 Layer::worldPositionToLatLon
             (const glm::vec2 &point) const {
         auto projectedPoint = point + mOriginLatLon;
@@ -40,95 +110,742 @@ namespace KCore {
 
     void Layer::setPosition
             (const glm::vec3 &position) {
+        if (position == mOriginPosition) return;
+
         mOriginPosition = position;
+        mPositionGeneration++;
     }
 
     void Layer::calculateTiles() {
-        mTiles = {};
-
         // store old tiles and clear up current
-        mPrevTiles = std::move(mCurrTiles);
-        mCurrTiles = {};
+        std::swap(mPrevTiles, mCurrTiles);
+        mCurrTiles.clear();
 
         processTiles();
     }
 
     void Layer::pushToCoreEvents
             (const LayerEvent &event) {
-        std::lock_guard<std::mutex> lock{mQueueLock};
-        mCoreEventsQueue.push_back(event);
+        // the frame thread never waits for the consumer, a full queue spills until the next push
+        flushCoreEventsSpill();
+        if (!mCoreEventsSpill.empty() || !mCoreEvents.tryPush(event))
+            mCoreEventsSpill.push_back(event);
+    }
+
+    std::size_t Layer::flushCoreEventsSpill() {
+        std::size_t flushed = 0;
+        while (flushed < mCoreEventsSpill.size() && mCoreEvents.tryPush(mCoreEventsSpill[flushed]))
+            flushed++;
+        mCoreEventsSpill.erase(mCoreEventsSpill.begin(), mCoreEventsSpill.begin() + (long) flushed);
+
+        return flushed;
     }
 
     void Layer::pushToImageEvents
-            (const LayerEvent &event) {
-        std::lock_guard<std::mutex> lock{mQueueLock};
-        mImageEventsQueue.push_back(event);
+            (const PendingImage &image) {
+        // network threads may wait for the consumer, they are off the frame path. Drain count is
+        // read before the push, so the drain between a failed push and the wait isn't missed
+        while (true) {
+            auto freed = mImageEventsFreed.load(std::memory_order_acquire);
+            if (mImageEvents.tryPush(image)) return;
+
+            if (mShuttingDown.load()) {
+                STBImageUtils::releaseImageBuffer(image.event.payload.image.data);
+                return;
+            }
+
+            mImageEventsFreed.wait(freed, std::memory_order_acquire);
+        }
     }
 
-    std::vector<LayerEvent> Layer::getCoreEventsCopyAndClearQueue() {
-        std::lock_guard<std::mutex> lock{mQueueLock};
+    void Layer::notifyImageEventsFreed() {
+        mImageEventsFreed.fetch_add(1, std::memory_order_release);
+        mImageEventsFreed.notify_all();
+    }
+
+    std::vector<LayerEvent> Layer::drainCoreEvents() {
+        if (mDeliveryRunning.load()) return {};
 
-        std::vector<LayerEvent> copy;
-        copy.insert(copy.end(), mCoreEventsQueue.begin(), mCoreEventsQueue.end());
+        std::vector<LayerEvent> events(mCoreEvents.size());
+        events.resize(drainCoreEvents(events.data(), events.size()));
+        return events;
+    }
 
-        mCoreEventsQueue.clear();
+    std::vector<LayerEvent> Layer::drainImageEvents() {
+        if (mDeliveryRunning.load()) return {};
 
-        return copy;
+        std::vector<LayerEvent> events(mImageEvents.size());
+        events.resize(drainImageEvents(events.data(), events.size()));
+        return events;
     }
 
-    std::vector<LayerEvent> Layer::getImageEventsCopyAndClearQueue() {
-        std::lock_guard<std::mutex> lock{mQueueLock};
+    std::size_t Layer::drainCoreEvents
+            (LayerEvent *out, std::size_t capacity) {
+        // queues have a single consumer, while the delivery thread runs it's that thread
+        if (mDeliveryRunning.load()) return 0;
 
-        std::vector<LayerEvent> copy;
-        copy.insert(copy.end(), mImageEventsQueue.begin(), mImageEventsQueue.end());
+        return popCoreEvents(out, capacity);
+    }
 
-        mImageEventsQueue.clear();
+    std::size_t Layer::drainImageEvents
+            (LayerEvent *out, std::size_t capacity) {
+        if (mDeliveryRunning.load()) return 0;
 
-        return copy;
+        return popImageEvents(out, capacity);
     }
 
-    std::vector<TileDescription> Layer::subdivideSpace
-            (float target) {
-        std::vector<TileDescription> tiles{};
+    std::size_t Layer::popCoreEvents
+            (LayerEvent *out, std::size_t capacity) {
+        std::size_t count = 0;
+
+        // cancelled pairs free room in the buffer, so it's refilled until nothing more fits
+        while (count < capacity) {
+            auto popped = mCoreEvents.pop(out + count, capacity - count);
+            if (popped == 0) break;
+
+            count = coalesceCoreEvents(out, count + popped);
+        }
 
-        // create tiles
-        for (const auto &item: std::vector{"0", "1", "2", "3"})
-            tiles.emplace_back(this, item);
+        return count;
+    }
+
+    std::size_t Layer::coalesceCoreEvents
+            (LayerEvent *events, std::size_t count) {
+        mCoalescedKeys.clear();
+        for (uint32_t i = 0; i < count; i++)
+            mCoalescedKeys.emplace_back(events[i].tilekey, i);
+        std::sort(mCoalescedKeys.begin(), mCoalescedKeys.end());
+
+        // events of one key alternate between InFrustum and NotInFrustum, so even run of them
+        // cancels out completely and odd one is worth its last event only
+        bool coalesced = false;
+        for (std::size_t begin = 0, end; begin < mCoalescedKeys.size(); begin = end) {
+            end = begin + 1;
+            while (end < mCoalescedKeys.size() && mCoalescedKeys[end].first == mCoalescedKeys[begin].first) end++;
+            if (end - begin == 1) continue;
+
+            auto last = (end - begin) % 2 == 1 ? end - 1 : end;
+            for (auto i = begin; i < last; i++)
+                events[mCoalescedKeys[i].second].tilekey = 0;
+            coalesced = true;
+        }
 
+        if (!coalesced) return count;
+
+        // zero is never valid key, it marks dropped events
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < count; i++)
+            if (events[i].tilekey != 0) events[kept++] = events[i];
+        return kept;
+    }
+
+    std::size_t Layer::popImageEvents
+            (LayerEvent *out, std::size_t capacity) {
         std::size_t count = 0;
-        while (count != tiles.size()) {
-            auto tile = &tiles[count];
-            auto quadcode = tile->getQuadcode();
+        bool popped = false;
+        PendingImage image;
 
-            if (screenSpaceError(*tile, target)) {
-                if (tile->getType() != TileType::Root) tile->setType(TileType::Separated);
-                tile->setVisibility(TileVisibility::Hide);
+        while (count < capacity && mImageEvents.tryPop(image)) {
+            popped = true;
 
-                for (const auto &item: std::vector{"0", "1", "2", "3"})
-                    tiles.emplace_back(this, quadcode + item);
+            // tile left or source changed after decode, host doesn't need these pixels anymore
+            if (image.request->isCancelled()) {
+                STBImageUtils::releaseImageBuffer(image.event.payload.image.data);
+                continue;
             }
 
-            count++;
+            out[count++] = image.event;
         }
 
-        return tiles;
+        if (popped) notifyImageEventsFreed();
+        return count;
     }
 
-    bool Layer::screenSpaceError
-            (TileDescription &tile, float target, float quality) {
-        const auto &quadcode = tile.getQuadcode();
+    void Layer::subdivideSpace
+            (float target) {
+        // create roots once, the rest of the tree lives between frames
+        if (!mRoots) {
+            mRoots = mNodePool.acquire();
+            for (int i = 0; i < 4; i++) mRoots[i] = TileNode(this, TileKey::root().child(i));
+        }
+
+        if (target != mCalculatedTarget) {
+            mCalculatedTarget = target;
+            mPositionGeneration++;
+        }
+
+        uint8_t planeMasks[4];
+        cullNodes(mRoots, FrustumCulling::ALL_PLANES, planeMasks);
+
+        mRefinementCandidates.clear();
+        auto *candidates = isRefinementBudgeted() ? &mRefinementCandidates : nullptr;
+
+        if (mVisibleTilesCap != 0) {
+            subdivideSpaceCapped(target, planeMasks);
+            return;
+        }
+
+        if (mSubdivisionPool) {
+            subdivideSpaceParallel(target, planeMasks);
+        } else {
+            for (int i = 0; i < 4; i++)
+                mStats.nodesVisited += updateNode(mRoots[i], target, planeMasks[i], mCurrTiles, candidates);
+        }
+
+        if (candidates) refineCandidates(target);
+    }
+
+    void Layer::subdivideSpaceParallel
+            (float target, const uint8_t *rootsPlaneMasks) {
+        // subtrees that took more than a share of last frame's work are split further,
+        // so a single deep branch doesn't end up on one worker
+        uint32_t lastNodes = 0;
+        for (int i = 0; i < 4; i++) lastNodes += mRoots[i].subtreeNodes;
+
+        auto slices = (mSubdivisionPool->getThreadsCount() + 1) * 8;
+        auto grain = std::max<uint32_t>(lastNodes / slices, 64);
+
+        mSubdivisionTasksCount = 0;
+        mSubdivisionSplitNodes.clear();
+
+        // tasks are collected in traversal order, so concatenated outputs keep it too
+        for (int i = 0; i < 4; i++)
+            splitSubtree(mRoots[i], target, rootsPlaneMasks[i], grain);
+
+        auto budgeted = isRefinementBudgeted();
+        mSubdivisionPool->run(mSubdivisionTasksCount, [this, target, budgeted](std::size_t index) {
+            auto &task = mSubdivisionTasks[index];
+            task.tiles.clear();
+            task.candidates.clear();
+            updateNode(*task.node, target, task.planeMask, task.tiles, budgeted ? &task.candidates : nullptr);
+        });
+
+        for (std::size_t i = 0; i < mSubdivisionTasksCount; i++) {
+            const auto &task = mSubdivisionTasks[i];
+
+            for (auto candidate: task.candidates) {
+                candidate.index += mCurrTiles.size();
+                mRefinementCandidates.push_back(candidate);
+            }
+            mCurrTiles.insert(mCurrTiles.end(), task.tiles.begin(), task.tiles.end());
+            mStats.nodesVisited += task.node->subtreeNodes;
+        }
+
+        // split nodes are stored in pre-order, in reverse every child is summed up before its parent
+        for (auto it = mSubdivisionSplitNodes.rbegin(); it != mSubdivisionSplitNodes.rend(); it++) {
+            auto &node = **it;
+            node.subtreeNodes = 1;
+            for (int i = 0; i < 4; i++) node.subtreeNodes += node.children[i].subtreeNodes;
+        }
+        mStats.nodesVisited += mSubdivisionSplitNodes.size();
+    }
+
+    void Layer::splitSubtree
+            (TileNode &node, float target, uint8_t planeMask, uint32_t grain) {
+        if (planeMask == FrustumCulling::OUTSIDE || node.subtreeNodes <= grain || !wantsSeparation(node, target)) {
+            addSubdivisionTask(node, planeMask);
+            return;
+        }
+
+        // same as separation in updateNode, children become tasks or get split too
+        if (!node.isSeparated()) separateNode(node);
+
+        node.description.setType(TileType::Separated);
+        node.description.setVisibility(TileVisibility::Hide);
+        mSubdivisionSplitNodes.push_back(&node);
+
+        uint8_t childrenPlaneMasks[4];
+        cullNodes(node.children, planeMask, childrenPlaneMasks);
 
-        if (!checkTileInFrustum(tile)) {
-            // if it's not in frustum just hide it without separation
+        for (int i = 0; i < 4; i++)
+            splitSubtree(node.children[i], target, childrenPlaneMasks[i], grain);
+    }
+
+    void Layer::addSubdivisionTask
+            (TileNode &node, uint8_t planeMask) {
+        // tasks and their buffers are reused between frames
+        if (mSubdivisionTasksCount == mSubdivisionTasks.size()) mSubdivisionTasks.emplace_back();
+
+        auto &task = mSubdivisionTasks[mSubdivisionTasksCount++];
+        task.node = &node;
+        task.planeMask = planeMask;
+    }
+
+    void Layer::setSubdivisionThreads
+            (int threads) {
+        mConfigChanged = true;
+        // one thread is the caller itself, so it's just the serial traversal
+        if (threads == 1) {
+            mSubdivisionPool.reset();
+            mSubdivisionTasks.clear();
+            mSubdivisionTasksCount = 0;
+            return;
+        }
+
+        mSubdivisionPool = std::make_unique<WorkerPool>(threads > 1 ? threads - 1 : 0);
+    }
+
+    void Layer::setRefinementBudget
+            (uint32_t nodes, float milliseconds) {
+        mConfigChanged = true;
+        mRefinementNodesBudget = nodes;
+        mRefinementTimeBudget = milliseconds;
+    }
+
+    bool Layer::isRefinementBudgeted() const {
+        return mRefinementNodesBudget != 0 || mRefinementTimeBudget > 0.0f;
+    }
+
+    void Layer::refineCandidates
+            (float target) {
+        // the most visible errors go first, whatever is left waits for the next frames
+        mRefinementQueue = mRefinementCandidates;
+        std::make_heap(mRefinementQueue.begin(), mRefinementQueue.end(), refinementOrder);
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t separated = 0;
+        bool refined = false;
+
+        while (!mRefinementQueue.empty()) {
+            if (refinementBudgetSpent(separated, start)) break;
+
+            std::pop_heap(mRefinementQueue.begin(), mRefinementQueue.end(), refinementOrder);
+            auto candidate = mRefinementQueue.back();
+            mRefinementQueue.pop_back();
+
+            auto &node = *candidate.node;
+            separateNode(node);
+            node.description.setType(TileType::Separated);
+            node.description.setVisibility(TileVisibility::Hide);
+            node.subtreeNodes = 5;
+            separated++;
+            refined = true;
+
+            uint8_t childrenPlaneMasks[4];
+            cullNodes(node.children, candidate.planeMask, childrenPlaneMasks);
+
+            for (int i = 0; i < 4; i++) {
+                auto &child = node.children[i];
+                child.subtreeNodes = 1;
+
+                if (childrenPlaneMasks[i] == FrustumCulling::OUTSIDE) {
+                    child.description.setVisibility(TileVisibility::Hide);
+                    continue;
+                }
+
+                child.description.setType(TileType::Leaf);
+                child.description.setVisibility(TileVisibility::Visible);
+
+                if (wantsSeparation(child, target)) {
+                    mRefinementQueue.push_back({&child, childrenPlaneMasks[i], child.error, 0});
+                    std::push_heap(mRefinementQueue.begin(), mRefinementQueue.end(), refinementOrder);
+                }
+            }
+        }
+
+        mStats.nodesVisited += separated * 4;
+        mStats.refinementsDeferred = mRefinementQueue.size();
+        if (!refined) return;
+
+        // refined candidates are replaced by their subtrees right where their leaves were
+        mRefinedTiles.clear();
+        std::size_t next = 0;
+        for (const auto &candidate: mRefinementCandidates) {
+            if (!candidate.node->isSeparated()) continue;
+
+            mRefinedTiles.insert(mRefinedTiles.end(), mCurrTiles.begin() + next, mCurrTiles.begin() + candidate.index);
+            emitSubtree(*candidate.node, mRefinedTiles);
+            next = candidate.index + 1;
+        }
+        mRefinedTiles.insert(mRefinedTiles.end(), mCurrTiles.begin() + next, mCurrTiles.end());
+
+        std::swap(mCurrTiles, mRefinedTiles);
+    }
+
+    bool Layer::refinementBudgetSpent
+            (uint32_t separated, std::chrono::steady_clock::time_point start) const {
+        if (mRefinementNodesBudget != 0 && separated >= mRefinementNodesBudget) return true;
+        if (mRefinementTimeBudget <= 0.0f) return false;
+
+        std::chrono::duration<float, std::milli> spent = std::chrono::steady_clock::now() - start;
+        return spent.count() >= mRefinementTimeBudget;
+    }
+
+    void Layer::subdivideSpaceCapped
+            (float target, const uint8_t *rootsPlaneMasks) {
+        // tree is refined from the top in error order, until leaves would exceed the cap
+        mRefinementQueue.clear();
+        uint32_t leaves = 0;
+
+        auto admit = [&](TileNode &node, uint8_t planeMask) {
+            mStats.nodesVisited++;
+            node.subtreeNodes = 1;
+
+            if (planeMask == FrustumCulling::OUTSIDE) {
+                node.description.setVisibility(TileVisibility::Hide);
+                dropChildren(node);
+                return;
+            }
+
+            node.description.setType(TileType::Leaf);
+            node.description.setVisibility(TileVisibility::Visible);
+            leaves++;
+
+            if (wantsSeparation(node, target)) {
+                mRefinementQueue.push_back({&node, planeMask, node.error, 0});
+                std::push_heap(mRefinementQueue.begin(), mRefinementQueue.end(), refinementOrder);
+            } else if (node.isSeparated()) {
+                mergeNode(node);
+            }
+        };
+
+        for (int i = 0; i < 4; i++) admit(mRoots[i], rootsPlaneMasks[i]);
+
+        auto start = std::chrono::steady_clock::now();
+        uint32_t separated = 0;
+        std::size_t deferred = 0;
+
+        // split replaces one leaf with up to four, so it's allowed while three more fit in
+        while (!mRefinementQueue.empty() && leaves + 3 <= mVisibleTilesCap) {
+            std::pop_heap(mRefinementQueue.begin(), mRefinementQueue.end(), refinementOrder);
+            auto candidate = mRefinementQueue.back();
+            mRefinementQueue.pop_back();
+
+            auto &node = *candidate.node;
+            if (!node.isSeparated()) {
+                // new tiles are still limited by the refinement budget, the leaf stays as it is
+                if (refinementBudgetSpent(separated, start)) {
+                    deferred++;
+                    continue;
+                }
+
+                separateNode(node);
+                separated++;
+            }
+
+            node.description.setType(TileType::Separated);
+            node.description.setVisibility(TileVisibility::Hide);
+            leaves--;
+
+            uint8_t childrenPlaneMasks[4];
+            cullNodes(node.children, candidate.planeMask, childrenPlaneMasks);
+
+            for (int i = 0; i < 4; i++) admit(node.children[i], childrenPlaneMasks[i]);
+        }
+
+        // nodes that didn't fit are shown as leaves, their old subtrees have to go
+        for (auto &candidate: mRefinementQueue) {
+            if (candidate.node->isSeparated()) mergeNode(*candidate.node);
+        }
+
+        mStats.refinementsDeferred = deferred;
+        mStats.tilesCapped = mRefinementQueue.size();
+
+        for (int i = 0; i < 4; i++) emitSubtree(mRoots[i], mCurrTiles);
+    }
+
+    void Layer::setElevationSource
+            (IElevationSource *source) {
+        mConfigChanged = true;
+        mElevationSource = source;
+
+        // bounds of existing nodes were sampled from the previous source
+        resetTree();
+    }
+
+    glm::vec2 Layer::sampleHeightRange
+            (const TileDescription &tile) const {
+        if (!mElevationSource) return {0.0f, 0.0f};
+
+        auto boundsLatLon = tile.getBoundsLatLon();
+
+        constexpr int SAMPLES = 5;
+
+        auto minHeight = std::numeric_limits<float>::max();
+        auto maxHeight = std::numeric_limits<float>::lowest();
+        for (int j = 0; j < SAMPLES; j++) {
+            for (int i = 0; i < SAMPLES; i++) {
+                auto lon = boundsLatLon[0] + (boundsLatLon[2] - boundsLatLon[0]) * (float) i / (SAMPLES - 1);
+                auto lat = boundsLatLon[1] + (boundsLatLon[3] - boundsLatLon[1]) * (float) j / (SAMPLES - 1);
+
+                // sources take longitude first, as in SRTMElevation::collectTileKernel
+                auto height = mElevationSource->getElevationAtLatLon(lon, lat);
+                minHeight = std::min(minHeight, height);
+                maxHeight = std::max(maxHeight, height);
+            }
+        }
+
+        // samples may miss peaks in between, keep some margin
+        auto margin = (maxHeight - minHeight) * 0.1f + 50.0f;
+        minHeight -= margin, maxHeight += margin;
+
+        // meters to world units, stretched the same way as mercator stretches the ground
+        auto centerLatitude = (boundsLatLon[1] + boundsLatLon[3]) / 2.0f;
+        auto scale = GeographyConverter::MULTIPLIER / std::cos(glm::radians(centerLatitude));
+
+        return {minHeight * scale, maxHeight * scale};
+    }
+
+    glm::vec2 Layer::tileHeightBounds
+            (const TileDescription &tile) const {
+        // without terrain the slab is wide enough for any height on earth
+        if (!mElevationSource) return {-1.0f, 1.0f};
+        return tile.getHeightRange();
+    }
+
+    void Layer::setVisibleTilesCap
+            (uint32_t cap) {
+        mConfigChanged = true;
+        // four roots may be visible at once, they can't be merged any further
+        mVisibleTilesCap = cap != 0 ? std::max<uint32_t>(cap, 4) : 0;
+    }
+
+    void Layer::emitSubtree
+            (const TileNode &node, std::vector<TileDescription> &tiles) const {
+        if (node.isSeparated()) {
+            for (int i = 0; i < 4; i++) emitSubtree(node.children[i], tiles);
+            return;
+        }
+
+        if (node.description.getVisibility() == TileVisibility::Visible)
+            tiles.push_back(node.description);
+    }
+
+    uint32_t Layer::updateNode
+            (TileNode &node, float target, uint8_t planeMask, std::vector<TileDescription> &tiles,
+             std::vector<RefinementCandidate> *candidates) {
+        auto &tile = node.description;
+
+        if (planeMask == FrustumCulling::OUTSIDE) {
+            // if it's not in frustum just hide it and drop the subtree
+            tile.setVisibility(TileVisibility::Hide);
+            dropChildren(node);
+            return node.subtreeNodes = 1;
+        }
+
+        auto separation = wantsSeparation(node, target);
+
+        // with a budget new tiles are created later, in error order, and the leaf stands in for now
+        if (separation && !node.isSeparated() && candidates) {
+            candidates->push_back({&node, planeMask, node.error, tiles.size()});
+            separation = false;
+        }
+
+        if (separation) {
+            // only a leaf that just crossed the threshold creates new tiles
+            if (!node.isSeparated()) separateNode(node);
+
+            tile.setType(TileType::Separated);
             tile.setVisibility(TileVisibility::Hide);
-            return false;
+
+            // siblings are culled together, only against planes their parent straddles
+            uint8_t childrenPlaneMasks[4];
+            cullNodes(node.children, planeMask, childrenPlaneMasks);
+
+            node.subtreeNodes = 1;
+            for (int i = 0; i < 4; i++)
+                node.subtreeNodes += updateNode(node.children[i], target, childrenPlaneMasks[i], tiles, candidates);
+            return node.subtreeNodes;
+        }
+
+        if (node.isSeparated()) mergeNode(node);
+
+        tile.setType(TileType::Leaf);
+        tile.setVisibility(TileVisibility::Visible);
+        tiles.push_back(tile);
+
+        return node.subtreeNodes = 1;
+    }
+
+    bool Layer::wantsSeparation
+            (TileNode &node, float target) {
+        // error is cached until the camera position changes
+        if (node.errorGeneration != mPositionGeneration) {
+            node.error = tileError(node.description);
+            node.errorGeneration = mPositionGeneration;
+        }
+
+        auto separated = node.isSeparated();
+        if (!separated && node.description.getKey().getZoom() >= TileKey::MAX_ZOOM) return false;
+
+        // gap between thresholds keeps nodes near the boundary from flipping every frame
+        auto wanted = node.error > target * (separated ? mMergeFactor : mSplitFactor);
+        if (wanted != separated && mFrameTime < node.changedAt + mMinDwellTime) {
+            // the frame has to be calculated again after the dwell, even on a still camera
+            mTransitionsHeld.fetch_add(1, std::memory_order_relaxed);
+            return separated;
         }
 
+        return wanted;
+    }
+
+    void Layer::separateNode
+            (TileNode &node) {
+        auto key = node.description.getKey();
+
+        node.children = mNodePool.acquire();
+        for (int i = 0; i < 4; i++) node.children[i] = TileNode(this, key.child(i));
+
+        node.changedAt = mFrameTime;
+    }
+
+    void Layer::mergeNode
+            (TileNode &node) {
+        dropChildren(node);
+        node.changedAt = mFrameTime;
+    }
+
+    void Layer::dropChildren
+            (TileNode &node) {
+        if (!node.children) return;
+
+        for (int i = 0; i < 4; i++) dropChildren(node.children[i]);
+
+        mNodePool.release(node.children);
+        node.children = nullptr;
+    }
+
+    void Layer::resetTree() {
+        if (!mRoots) return;
+
+        for (int i = 0; i < 4; i++) dropChildren(mRoots[i]);
+
+        mNodePool.release(mRoots);
+        mRoots = nullptr;
+        mPrefetchExhausted = false;
+    }
+
+    void Layer::setLodHysteresis
+            (float splitFactor, float mergeFactor, float minDwellTime) {
+        mConfigChanged = true;
+        mSplitFactor = splitFactor;
+        mMergeFactor = std::min(mergeFactor, splitFactor);
+        mMinDwellTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<float>(std::max(minDwellTime, 0.0f)));
+    }
+
+    bool Layer::screenSpaceError
+            (TileDescription &tile, float target, float quality) {
+        return tileError(tile, quality) > target;
+    }
+
+    float Layer::tileError
+            (const TileDescription &tile, float quality) const {
+        return tileError(tile, mOriginPosition, quality);
+    }
+
+    float Layer::tileError
+            (const TileDescription &tile, const glm::vec3 &position, float quality) const {
+        return quality * tile.getScale() / tileDistance(tile, position);
+    }
+
+    float Layer::tileDistance
+            (const TileDescription &tile, const glm::vec3 &position) const {
+        // nearest point of the tile's vertical extent above its center
         auto center = tile.getCenter();
-        auto distance = glm::length(glm::vec3(center.x, 0, center.y) - mOriginPosition);
-        auto error = quality * tile.getScale() / distance;
+        auto height = tile.getHeightRange();
+        auto y = std::clamp(position.y, height.x, height.y);
+
+        return glm::length(glm::vec3(center.x, y, center.y) - position);
+    }
+
+    void Layer::prefetch
+            (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix,
+             const glm::vec3 &position, float target) {
+        // same prediction as before that found less than the limit, its tiles are all queued or sent
+        auto viewProjection = projectionMatrix * viewMatrix;
+        if (mPrefetchExhausted && viewProjection == mPrefetchViewProjection && position == mPrefetchPosition)
+            return;
 
-        return error > target;
+        mPrefetchViewProjection = viewProjection;
+        mPrefetchPosition = position;
+        mPrefetchCullingFilter.updateFrustum(projectionMatrix, viewMatrix);
+
+        // keys are kept only to avoid asking the cache again, old ones may go
+        if (mPrefetchedKeys.size() > 4096) mPrefetchedKeys.clear();
+
+        // prefetches of the previous prediction that haven't started yet are replaced by new ones
+        std::erase_if(mPendingRequests, [](const PendingRequest &pending) {
+            return pending.request == nullptr;
+        });
+
+        auto limit = mPrefetchLimit;
+        if (mRoots) {
+            for (int i = 0; i < 4 && limit != 0; i++)
+                prefetchFrontier(mRoots[i], position, target, FrustumCulling::ALL_PLANES, limit);
+        } else {
+            for (int i = 0; i < 4 && limit != 0; i++)
+                prefetchNode(TileDescription{this, TileKey::root().child(i)}, position, target,
+                             FrustumCulling::ALL_PLANES, limit);
+        }
+
+        mPrefetchExhausted = limit != 0;
+    }
+
+    void Layer::prefetchFrontier
+            (const TileNode &node, const glm::vec3 &position, float target, uint8_t planeMask, uint32_t &limit) {
+        // nodes of the current tree are reused, new descriptions are made only below its leaves
+        if (!node.isSeparated()) {
+            prefetchNode(node.description, position, target, planeMask, limit);
+            return;
+        }
+
+        const auto &tile = node.description;
+        auto pos = tile.getCenter();
+        auto scale = tile.getScale();
+        auto height = tileHeightBounds(tile);
+        auto state = mPrefetchCullingFilter.testAABB(pos.x - scale / 2.0f, height.x, pos.y - scale / 2.0f,
+                                                     pos.x + scale / 2.0f, height.y, pos.y + scale / 2.0f,
+                                                     planeMask);
+        if (state == CullingState::Outside) return;
+
+        if (tileError(tile, position) > target) {
+            for (int i = 0; i < 4 && limit != 0; i++)
+                prefetchFrontier(node.children[i], position, target, planeMask, limit);
+            return;
+        }
+
+        // predicted camera would merge the node, it isn't visible now
+        if (mPrefetchedKeys.contains(tile.getKey())) return;
+        mPendingRequests.push_back({tile, nullptr, 0, 0.0f});
+        limit--;
+    }
+
+    void Layer::prefetchNode
+            (const TileDescription &tile, const glm::vec3 &position, float target, uint8_t planeMask,
+             uint32_t &limit) {
+        auto key = tile.getKey();
+        auto pos = tile.getCenter();
+        auto scale = tile.getScale();
+        auto height = tileHeightBounds(tile);
+        auto state = mPrefetchCullingFilter.testAABB(pos.x - scale / 2.0f, height.x, pos.y - scale / 2.0f,
+                                                     pos.x + scale / 2.0f, height.y, pos.y + scale / 2.0f,
+                                                     planeMask);
+        if (state == CullingState::Outside) return;
+
+        if (key.getZoom() < TileKey::MAX_ZOOM && tileError(tile, position) > target) {
+            // below the current tree nothing is kept, the predicted tiles are made from scratch
+            for (int i = 0; i < 4 && limit != 0; i++)
+                prefetchNode(TileDescription{this, key.child(i)}, position, target, planeMask, limit);
+            return;
+        }
+
+        // visible tiles are requested by the usual path
+        if (isVisible(key) || mPrefetchedKeys.contains(key)) return;
+
+        // scheduler starts them after raster requests of visible tiles only
+        mPendingRequests.push_back({tile, nullptr, 0, 0.0f});
+        limit--;
+    }
+
+    bool Layer::isVisible
+            (TileKey key) const {
+        // current set is sorted in traversal order
+        auto it = std::lower_bound(mCurrTiles.begin(), mCurrTiles.end(), key,
+                                   [](const TileDescription &tile, TileKey key) {
+                                       return TileKey::traversalLess(tile.getKey(), key);
+                                   });
+        return it != mCurrTiles.end() && it->getKey() == key;
     }
 
     bool Layer::checkTileInFrustum
@@ -140,51 +857,292 @@ namespace KCore {
         float maxX = pos.x + scale / 2.0f;
         float minZ = pos.y - scale / 2.0f;
         float maxZ = pos.y + scale / 2.0f;
-        float minY = -1.0f, maxY = 1.0f;
+        auto height = tileHeightBounds(tile);
+        float minY = height.x, maxY = height.y;
 
         return mCullingFilter.testAABB(minX, minY, minZ, maxX, maxY, maxZ);
     }
 
+    void Layer::cullNodes
+            (const TileNode *nodes, uint8_t planeMask, uint8_t *results) const {
+        // parent is fully inside, so are its children
+        if (planeMask == 0) {
+            std::fill(results, results + 4, 0);
+            return;
+        }
+
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+
+        for (int i = 0; i < 4; i++) {
+            auto pos = nodes[i].description.getCenter();
+            auto scale = nodes[i].description.getScale();
+
+            minX[i] = pos.x - scale / 2.0f;
+            maxX[i] = pos.x + scale / 2.0f;
+            minZ[i] = pos.y - scale / 2.0f;
+            maxZ[i] = pos.y + scale / 2.0f;
+            auto height = tileHeightBounds(nodes[i].description);
+            minY[i] = height.x, maxY[i] = height.y;
+        }
+
+        mCullingFilter.testAABBBatch({minX, minY, minZ, maxX, maxY, maxZ, 4}, planeMask, results);
+    }
+
     void Layer::setRasterUrl
             (const char *url) {
-        mRemoteSource = std::make_unique<RemoteSource>(url);
+        // urls are baked into fixed buffers, source that may not fit there is refused
+        auto source = std::make_unique<RemoteSource>(url);
+        if (!source->fitsRequestUrl()) return;
+
+        mConfigChanged = true;
+        // images of the old source are dropped, visible tiles are requested again from the new one
+        for (auto &requested: mRequested)
+            requested.request->cancel();
         mRequested.clear();
+        mPendingRequests.clear();
+
+        mRemoteSource = std::move(source);
+        mPrefetchedKeys.clear();
+        mPrefetchExhausted = false;
+
+        for (const auto &tile: mCurrTiles)
+            requestImage(tile);
     }
 
-    void Layer::processTiles
-            (float target) {
-        auto subdivisionResult = subdivideSpace(target);
+    void Layer::setEventCallback
+            (LayerEventType type, LayerEventCallback callback, void *context) {
+        if (type < InFrustum || type > ImageReady) return;
+        mConfigChanged = true;
 
-        // filter & associate
-        for (auto &item: subdivisionResult) {
-            if (item.getVisibility() == Visible) {
-                mCurrTiles[item.getQuadcode()] = item;
-                mTiles.push_back(item);
-            }
+        // delivery thread reads callbacks without lock, so it's parked while they change
+        bool delivering = mDeliveryRunning.load();
+        setEventDeliveryThread(false);
+
+        mEventCallbacks[type] = callback;
+        mEventContexts[type] = context;
+
+        setEventDeliveryThread(delivering);
+    }
+
+    void Layer::setEventDeliveryThread
+            (bool enabled) {
+        mConfigChanged = true;
+        if (enabled == mDeliveryRunning.load()) return;
+
+        if (enabled) {
+            mDeliveryStopped.store(false);
+            mDeliveryRunning.store(true);
+            mDeliveryThread = std::thread{&Layer::runDelivery, this};
+            return;
         }
 
-        auto diff = mapKeysDifference<std::string>(mCurrTiles, mPrevTiles);
-        auto inter = mapKeysIntersection<std::string>(mCurrTiles, mPrevTiles);
+        mDeliveryRunning.store(false);
+        mDeliveryStopped.store(true);
+        mDeliverySignal.fetch_add(1, std::memory_order_release);
+        mDeliverySignal.notify_all();
+        mDeliveryThread.join();
+    }
 
-        for (auto &quadcode: diff) {
-            bool inPrev = mPrevTiles.contains(quadcode);
-            bool inNew = mCurrTiles.contains(quadcode);
+    std::size_t Layer::dispatchEvents() {
+        // delivery thread is the only consumer while it runs, host dispatch would race with it
+        if (mDeliveryRunning.load()) return 0;
 
-            if (inNew) {
-                auto desc = mCurrTiles[quadcode];
+        return deliverQueuedEvents();
+    }
 
-                pushToCoreEvents(LayerEvent::MakeInFrustumEvent(quadcode, mCurrTiles[quadcode]));
+    std::size_t Layer::deliverQueuedEvents() {
+        std::size_t dispatched = 0, count;
 
-                mNetworkAdapter->AsyncGETRequest(
-                        mRemoteSource->bakeUrl(desc),
-                        [this, quadcode](const std::vector<uint8_t> &result) {
-                            pushToImageEvents(LayerEvent::MakeImageEvent(quadcode, result));
-                        }
-                );
-            }
+        while ((count = popCoreEvents(mDispatchBuffer.data(), mDispatchBuffer.size())) > 0) {
+            deliverEvents(mDispatchBuffer.data(), count);
+            dispatched += count;
+        }
 
-            if (inPrev)
-                pushToCoreEvents(LayerEvent::MakeNotInFrustumEvent(quadcode));
+        while ((count = popImageEvents(mDispatchBuffer.data(), mDispatchBuffer.size())) > 0) {
+            deliverEvents(mDispatchBuffer.data(), count);
+            dispatched += count;
         }
+
+        return dispatched;
+    }
+
+    void Layer::deliverEvents
+            (LayerEvent *events, std::size_t count) {
+        // runs of one type keep the order of events and go to its callback as one batch
+        for (std::size_t begin = 0, end; begin < count; begin = end) {
+            end = begin + 1;
+            while (end < count && events[end].type == events[begin].type) end++;
+
+            auto type = events[begin].type;
+            if (mEventCallbacks[type] != nullptr)
+                mEventCallbacks[type](mEventContexts[type], events + begin, (int) (end - begin));
+        }
+
+        // pixels are valid only inside callback
+        for (std::size_t i = 0; i < count; i++)
+            if (events[i].type == ImageReady)
+                STBImageUtils::releaseImageBuffer(events[i].payload.image.data);
+    }
+
+    void Layer::notifyDelivery() {
+        if (!mDeliveryRunning.load(std::memory_order_relaxed)) return;
+
+        // producers never wait here, delivery thread is just woken up
+        mDeliverySignal.fetch_add(1, std::memory_order_release);
+        mDeliverySignal.notify_one();
+    }
+
+    void Layer::runDelivery() {
+        while (!mDeliveryStopped.load()) {
+            auto signal = mDeliverySignal.load(std::memory_order_acquire);
+
+            deliverQueuedEvents();
+
+            mDeliverySignal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    void Layer::setNetworkThreads
+            (int threads) {
+        mConfigChanged = true;
+        mNetworkAdapter->setRequestThreads(threads > 0 ? threads : 1);
+    }
+
+    void Layer::setRequestsPerFrame
+            (uint32_t requests) {
+        mConfigChanged = true;
+        mRequestsPerFrame = requests;
+    }
+
+    void Layer::requestImage
+            (const TileDescription &tile) {
+        auto request = makeRequestHandle();
+
+        auto key = tile.getKey();
+        auto it = findRequested(key);
+        if (it != mRequested.end() && it->key == key) it->request = request;
+        else mRequested.insert(it, {key, request});
+
+        mPendingRequests.push_back({tile, request, 0, 0.0f});
+    }
+
+    void Layer::scheduleRequests() {
+        // tiles that have left meanwhile are never requested, predicted ones that came into view
+        // are requested by the usual path
+        std::erase_if(mPendingRequests, [this](const PendingRequest &pending) {
+            if (pending.request == nullptr) return isVisible(pending.tile.getKey());
+            return pending.request->isCancelled();
+        });
+
+        // prefetches are the lowest class, they take only what visible tiles leave of the frame
+        for (auto &pending: mPendingRequests) {
+            pending.distance = tileDistance(pending.tile, mOriginPosition);
+            pending.errorClass = pending.request != nullptr
+                                 ? (int) std::floor(std::log2(tileError(pending.tile)))
+                                 : std::numeric_limits<int>::min();
+        }
+
+        // the greatest screen space error first, then the nearest, then the coarsest
+        auto priority = [](const PendingRequest &lhs, const PendingRequest &rhs) {
+            if (lhs.errorClass != rhs.errorClass) return lhs.errorClass > rhs.errorClass;
+            if (lhs.distance != rhs.distance) return lhs.distance < rhs.distance;
+            if (lhs.tile.getKey().getZoom() != rhs.tile.getKey().getZoom())
+                return lhs.tile.getKey().getZoom() < rhs.tile.getKey().getZoom();
+            return lhs.tile.getKey() < rhs.tile.getKey();
+        };
+
+        auto limit = mRequestsPerFrame > 0 ? std::min<std::size_t>(mRequestsPerFrame, mPendingRequests.size())
+                                           : mPendingRequests.size();
+        std::partial_sort(mPendingRequests.begin(), mPendingRequests.begin() + (long) limit,
+                          mPendingRequests.end(), priority);
+
+        // network queue may refuse them too, the rest waits for next frames and is ordered again
+        std::size_t started = 0, prefetched = 0;
+        for (; started < limit; started++) {
+            const auto &pending = mPendingRequests[started];
+            if (pending.request == nullptr) {
+                if (!submitPrefetchRequest(pending.tile)) break;
+                prefetched++;
+            } else if (!submitImageRequest(pending.tile, pending.request)) break;
+        }
+        mPendingRequests.erase(mPendingRequests.begin(), mPendingRequests.begin() + (long) started);
+
+        auto pendingPrefetches = std::count_if(mPendingRequests.begin(), mPendingRequests.end(),
+                                               [](const PendingRequest &pending) { return pending.request == nullptr; });
+
+        mStats.requestsStarted = (uint32_t) (started - prefetched);
+        mStats.requestsPending = (uint32_t) (mPendingRequests.size() - pendingPrefetches);
+        mStats.tilesPrefetched = (uint32_t) prefetched;
+    }
+
+    bool Layer::submitPrefetchRequest
+            (const TileDescription &tile) {
+        // prefetch lane of the adapter is full, the tile is tried again on next frames
+        if (!mNetworkAdapter->AsyncPrefetch(mRemoteSource->bakeUrl(tile))) return false;
+
+        mPrefetchedKeys.insert(tile.getKey());
+        return true;
+    }
+
+    bool Layer::submitImageRequest
+            (const TileDescription &tile, const RequestHandle &request) {
+        auto key = tile.getKey();
+
+        // adapter doesn't call back for cancelled request, so there's no decode of gone tiles
+        auto handle = mNetworkAdapter->AsyncGETRequest(
+                mRemoteSource->bakeUrl(tile),
+                [this, key, request](const ByteBuffer &result) {
+                    pushToImageEvents({LayerEvent::MakeImageEvent(key, *result), request});
+                    notifyDelivery();
+                },
+                request
+        );
+
+        return handle != nullptr;
+    }
+
+    void Layer::cancelImage
+            (TileKey key) {
+        auto it = findRequested(key);
+        if (it == mRequested.end() || it->key != key) return;
+
+        // queued download is skipped, the one in flight ends up in cache only
+        it->request->cancel();
+        mRequested.erase(it);
+    }
+
+    std::vector<RequestedTile>::iterator Layer::findRequested
+            (TileKey key) {
+        return std::lower_bound(mRequested.begin(), mRequested.end(), key,
+                                [](const RequestedTile &requested, TileKey key) { return requested.key < key; });
+    }
+
+    void Layer::processTiles
+            (float target) {
+        // leaves are collected depth-first, so both sets are already in traversal order
+        auto flushed = flushCoreEventsSpill();
+
+        subdivideSpace(target);
+        mTilesDiff.compute(mPrevTiles, mCurrTiles);
+
+        for (auto index: mTilesDiff.getAdded()) {
+            const auto &desc = mCurrTiles[index];
+
+            pushToCoreEvents(LayerEvent::MakeInFrustumEvent(desc.getKey(), desc));
+            requestImage(desc);
+        }
+
+        for (auto index: mTilesDiff.getRemoved()) {
+            auto key = mPrevTiles[index].getKey();
+
+            pushToCoreEvents(LayerEvent::MakeNotInFrustumEvent(key));
+            cancelImage(key);
+        }
+
+        scheduleRequests();
+
+        if (flushed > 0 || !mTilesDiff.getAdded().empty() || !mTilesDiff.getRemoved().empty())
+            notifyDelivery();
     }
 }
\ No newline at end of file
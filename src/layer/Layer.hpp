@@ -1,43 +1,184 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
-#include <mutex>
+#include <memory>
+#include <thread>
+#include <unordered_set>
 
 #include "LRUCache17.hpp"
 
+#include "LayerStats.hpp"
 #include "RemoteSource.hpp"
+#include "TileNode.hpp"
+#include "TileNodePool.hpp"
+#include "TileSetDiff.hpp"
 #include "events/LayerEvent.hpp"
 #include "../misc/FrustumCulling.hpp"
+#include "../misc/MPSCQueue.hpp"
+#include "../misc/WorkerPool.hpp"
+#include "../elevation/IElevationSource.hpp"
 #include "../geography/TileDescription.hpp"
 #include "../network/INetworkAdapter.hpp"
 
 namespace KCore {
+    // leaf that wants to be separated, postponed to the budgeted refinement
+    struct RefinementCandidate {
+        TileNode *node;
+        uint8_t planeMask;
+        float error;
+        // position of its leaf in the visible set
+        std::size_t index;
+    };
+
+    // subtree traversed by one worker, leaves are collected into its own buffer
+    struct SubdivisionTask {
+        TileNode *node{nullptr};
+        uint8_t planeMask{0};
+        std::vector<TileDescription> tiles{};
+        std::vector<RefinementCandidate> candidates{};
+    };
+
+    // visible tile waiting for its raster request to start, ordered by priority every frame
+    struct PendingRequest {
+        TileDescription tile;
+        // prefetch into the network cache has no handle, nobody waits for it
+        RequestHandle request;
+        // screen space error rounded down to power of two, leaves differ in it only when they're far from target
+        int errorClass;
+        float distance;
+    };
+
+    // request of a visible tile, they're kept sorted by key
+    struct RequestedTile {
+        TileKey key;
+        RequestHandle request;
+    };
+
+    // decoded image waiting for the host together with the request it answers, the frame thread
+    // cancels the request when the tile leaves or the source changes
+    struct PendingImage {
+        LayerEvent event{};
+        RequestHandle request{nullptr};
+    };
+
     class Layer {
     private:
         glm::vec2 mOriginLatLon{};
         glm::vec3 mOriginPosition{};
 
+        // bumped on every camera move, node errors of older generations are stale
+        uint64_t mPositionGeneration{1}, mCalculatedGeneration{0};
+        float mCalculatedTarget{0.0f};
+
+        LayerStats mStats{};
+
         KCore::FrustumCulling mCullingFilter{};
 
-        std::vector<TileDescription> mTiles{};
-        std::map<std::string, TileDescription> mPrevTiles, mCurrTiles{};
+        // persistent quadtree, refined and merged in place between frames.
+        // Pool owns every node, roots are the first block of four
+        TileNodePool mNodePool{};
+        TileNode *mRoots{nullptr};
+
+        // visible tiles of previous and current frame in traversal order
+        std::vector<TileDescription> mPrevTiles{}, mCurrTiles{};
+        TileSetDiff mTilesDiff{};
+
+        // parallel subdivision, serial traversal when there is no pool
+        std::unique_ptr<WorkerPool> mSubdivisionPool{nullptr};
+        std::vector<SubdivisionTask> mSubdivisionTasks{};
+        std::size_t mSubdivisionTasksCount{0};
+        std::vector<TileNode *> mSubdivisionSplitNodes{};
+
+        // new separations per frame are limited by count and time, zero means no limit
+        uint32_t mRefinementNodesBudget{0};
+        float mRefinementTimeBudget{0.0f};
+        std::vector<RefinementCandidate> mRefinementCandidates{}, mRefinementQueue{};
+        std::vector<TileDescription> mRefinedTiles{};
+
+        // tiles of the predicted camera that were already sent to the cache
+        KCore::FrustumCulling mPrefetchCullingFilter{};
+        std::unordered_set<TileKey> mPrefetchedKeys{};
+        uint32_t mPrefetchLimit{16};
+        // last predicted camera, pass is skipped while it stays and found less than the limit
+        glm::mat4 mPrefetchViewProjection{0.0f};
+        glm::vec3 mPrefetchPosition{0.0f};
+        bool mPrefetchExhausted{false};
+
+        // node splits above target * split factor and merges only below target * merge factor,
+        // and keeps its state at least for dwell time. Factors of 1.0 turn hysteresis off
+        float mSplitFactor{1.0f}, mMergeFactor{1.0f};
+        std::chrono::steady_clock::duration mMinDwellTime{0};
+        std::chrono::steady_clock::time_point mFrameTime{};
+        // splits and merges held back by the dwell time in the current frame, counted by workers too
+        std::atomic<uint32_t> mTransitionsHeld{0};
 
-        INetworkAdapter *mNetworkAdapter;
+        // set by configuration setters, the next frame is calculated even on a still camera
+        bool mConfigChanged{false};
 
-        std::map<std::string, bool> mRequested;
+        // hard limit of visible tiles, zero means no limit
+        uint32_t mVisibleTilesCap{0};
+
+        std::unique_ptr<INetworkAdapter> mNetworkAdapter;
+
+        // terrain heights for tile bounds, owned by the caller
+        IElevationSource *mElevationSource{nullptr};
+
+        // requests of visible tiles, owned by the frame thread. Both vectors are reserved up front,
+        // so tiles coming into view don't allocate until there are more than that at once
+        constexpr static std::size_t REQUESTS_RESERVE = 1024;
+        std::vector<RequestedTile> mRequested;
+        // requests not started yet, the most important ones go first within the per frame limit
+        std::vector<PendingRequest> mPendingRequests;
+        uint32_t mRequestsPerFrame{16};
         std::unique_ptr<RemoteSource> mRemoteSource{nullptr};
 
-        std::mutex mQueueLock;
-        std::vector<LayerEvent> mCoreEventsQueue, mImageEventsQueue;
+        constexpr static std::size_t CORE_EVENTS_CAPACITY = 4096;
+        constexpr static std::size_t IMAGE_EVENTS_CAPACITY = 1024;
+
+        // core events come from the frame thread only, image events from network threads,
+        // both are drained by the render thread
+        MPSCQueue<LayerEvent, CORE_EVENTS_CAPACITY> mCoreEvents;
+        MPSCQueue<PendingImage, IMAGE_EVENTS_CAPACITY> mImageEvents;
+
+        // core events that didn't fit into a full queue, owned by the frame thread
+        std::vector<LayerEvent> mCoreEventsSpill;
+
+        // keys of drained core events sorted for coalescing, owned by the render thread
+        std::vector<std::pair<uint64_t, uint32_t>> mCoalescedKeys;
+
+        constexpr static std::size_t DISPATCH_BATCH = 256;
+
+        // push delivery: host callbacks by event type, fired from dispatchEvents on host's thread
+        // or on own delivery thread which is woken by producers
+        std::array<LayerEventCallback, 3> mEventCallbacks{};
+        std::array<void *, 3> mEventContexts{};
+        std::array<LayerEvent, DISPATCH_BATCH> mDispatchBuffer{};
+
+        std::thread mDeliveryThread;
+        std::atomic<bool> mDeliveryRunning{false}, mDeliveryStopped{false};
+        std::atomic<uint32_t> mDeliverySignal{0};
+
+        // network workers stop waiting for room in the images queue
+        std::atomic<bool> mShuttingDown{false};
+        // bumped by every drain of the images queue, network workers sleep on it while the queue is full
+        std::atomic<uint32_t> mImageEventsFreed{0};
 
     public:
         Layer();
 
         Layer(float latitude, float longitude);
 
+        ~Layer();
+
         [[nodiscard]] glm::vec2 latLonToWorldPosition
                 (const glm::vec2 &latLon) const;
 
+        [[nodiscard]] glm::vec2 tileCornerToWorldPosition
+                (uint32_t x, uint32_t y, int z) const;
+
         [[nodiscard]] glm::vec2 worldPositionToLatLon
                 (const glm::vec2 &point) const;
 
@@ -49,6 +190,12 @@ namespace KCore {
 
         void update();
 
+        void skipFrame();
+
+        [[nodiscard]] const LayerStats &getStats() const;
+
+        [[nodiscard]] bool isConfigChanged() const;
+
         void processTiles
                 (float target = 1.0f);
 
@@ -56,23 +203,181 @@ namespace KCore {
                 (const LayerEvent &event);
 
         void pushToImageEvents
-                (const LayerEvent &event);
+                (const PendingImage &image);
 
-        std::vector<TileDescription> subdivideSpace
+        void subdivideSpace
                 (float target = 1.0);
 
+        uint32_t updateNode
+                (TileNode &node, float target, uint8_t planeMask, std::vector<TileDescription> &tiles,
+                 std::vector<RefinementCandidate> *candidates = nullptr);
+
+        void setSubdivisionThreads
+                (int threads);
+
+        void setRefinementBudget
+                (uint32_t nodes, float milliseconds);
+
+        void setLodHysteresis
+                (float splitFactor, float mergeFactor, float minDwellTime);
+
+        void setVisibleTilesCap
+                (uint32_t cap);
+
+        void setElevationSource
+                (IElevationSource *source);
+
+        [[nodiscard]] glm::vec2 sampleHeightRange
+                (const TileDescription &tile) const;
+
+        [[nodiscard]] glm::vec2 tileHeightBounds
+                (const TileDescription &tile) const;
+
+        void prefetch
+                (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix,
+                 const glm::vec3 &position, float target = 1.0f);
+
+        void cullNodes
+                (const TileNode *nodes, uint8_t planeMask, uint8_t *results) const;
+
         void calculateTiles();
 
+        bool wantsSeparation
+                (TileNode &node, float target);
+
         bool screenSpaceError
                 (TileDescription &tile, float target, float quality = 3.0f);
 
+        [[nodiscard]] float tileError
+                (const TileDescription &tile, float quality = 3.0f) const;
+
+        [[nodiscard]] float tileError
+                (const TileDescription &tile, const glm::vec3 &position, float quality = 3.0f) const;
+
+        [[nodiscard]] float tileDistance
+                (const TileDescription &tile, const glm::vec3 &position) const;
+
         bool checkTileInFrustum
                 (const TileDescription &tile);
 
-        std::vector<LayerEvent> getCoreEventsCopyAndClearQueue();
+        std::vector<LayerEvent> drainCoreEvents();
 
-        std::vector<LayerEvent> getImageEventsCopyAndClearQueue();
+        std::vector<LayerEvent> drainImageEvents();
+
+        // moves up to capacity events into caller memory, the rest stays queued.
+        // Drains nothing while the delivery thread runs, it's the only consumer then
+        std::size_t drainCoreEvents
+                (LayerEvent *out, std::size_t capacity);
+
+        std::size_t drainImageEvents
+                (LayerEvent *out, std::size_t capacity);
 
         void setRasterUrl(const char *url);
+
+        void setNetworkThreads
+                (int threads);
+
+        // zero means no limit
+        void setRequestsPerFrame
+                (uint32_t requests);
+
+        // events of type with callback go only to it, the rest are released on dispatch
+        void setEventCallback
+                (LayerEventType type, LayerEventCallback callback, void *context);
+
+        // delivery thread becomes the only consumer of events, host must not drain them then
+        void setEventDeliveryThread
+                (bool enabled);
+
+        // drains both queues into callbacks by batches, returns count of drained events.
+        // Does nothing and returns 0 while the delivery thread runs
+        std::size_t dispatchEvents();
+
+    private:
+        // returns count of events moved into the queue
+        std::size_t flushCoreEventsSpill();
+
+        std::size_t popCoreEvents
+                (LayerEvent *out, std::size_t capacity);
+
+        std::size_t popImageEvents
+                (LayerEvent *out, std::size_t capacity);
+
+        std::size_t coalesceCoreEvents
+                (LayerEvent *events, std::size_t count);
+
+        void requestImage
+                (const TileDescription &tile);
+
+        bool submitPrefetchRequest
+                (const TileDescription &tile);
+
+        bool submitImageRequest
+                (const TileDescription &tile, const RequestHandle &request);
+
+        void scheduleRequests();
+
+        void cancelImage
+                (TileKey key);
+
+        void deliverEvents
+                (LayerEvent *events, std::size_t count);
+
+        void notifyDelivery();
+
+        std::size_t deliverQueuedEvents();
+
+        void notifyImageEventsFreed();
+
+        void runDelivery();
+
+        void subdivideSpaceParallel
+                (float target, const uint8_t *rootsPlaneMasks);
+
+        void splitSubtree
+                (TileNode &node, float target, uint8_t planeMask, uint32_t grain);
+
+        void addSubdivisionTask
+                (TileNode &node, uint8_t planeMask);
+
+        [[nodiscard]] bool isRefinementBudgeted() const;
+
+        void separateNode
+                (TileNode &node);
+
+        void mergeNode
+                (TileNode &node);
+
+        void dropChildren
+                (TileNode &node);
+
+        void resetTree();
+
+        void refineCandidates
+                (float target);
+
+        [[nodiscard]] bool refinementBudgetSpent
+                (uint32_t separated, std::chrono::steady_clock::time_point start) const;
+
+        void subdivideSpaceCapped
+                (float target, const uint8_t *rootsPlaneMasks);
+
+        void emitSubtree
+                (const TileNode &node, std::vector<TileDescription> &tiles) const;
+
+        void prefetchFrontier
+                (const TileNode &node, const glm::vec3 &position, float target, uint8_t planeMask,
+                 uint32_t &limit);
+
+        void prefetchNode
+                (const TileDescription &tile, const glm::vec3 &position, float target, uint8_t planeMask,
+                 uint32_t &limit);
+
+        [[nodiscard]] bool isVisible
+                (TileKey key) const;
+
+        // first request with key not less than given one
+        std::vector<RequestedTile>::iterator findRequested
+                (TileKey key);
     };
 }
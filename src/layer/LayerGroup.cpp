@@ -0,0 +1,85 @@
+#include "LayerGroup.hpp"
+
+#include <algorithm>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace KCore {
+    LayerGroup::LayerGroup
+            (int threads) : mPool(threads > 0 ? threads : 0) {}
+
+    void LayerGroup::addLayer
+            (LayerInterface *layer) {
+        if (std::find(mLayers.begin(), mLayers.end(), layer) != mLayers.end()) return;
+        mLayers.push_back(layer);
+    }
+
+    void LayerGroup::removeLayer
+            (LayerInterface *layer) {
+        std::erase(mLayers, layer);
+    }
+
+    void LayerGroup::update
+            (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix) {
+        mCameraProjectionMatrix = projectionMatrix;
+        mCameraViewMatrix = viewMatrix;
+        mCameraPosition = glm::inverse(viewMatrix)[3];
+        mCameraShared = true;
+    }
+
+    void LayerGroup::update
+            (const float *projectionMatrix_ptr, const float *viewMatrix_ptr,
+             bool transposeProjectionMatrix, bool transposeViewMatrix) {
+        auto projectionMatrix = glm::make_mat4x4(projectionMatrix_ptr);
+        if (transposeProjectionMatrix) projectionMatrix = glm::transpose(projectionMatrix);
+
+        auto viewMatrix = glm::make_mat4x4(viewMatrix_ptr);
+        if (transposeViewMatrix) viewMatrix = glm::transpose(viewMatrix);
+
+        update(projectionMatrix, viewMatrix);
+    }
+
+    void LayerGroup::calculate() {
+        // layers don't share any state, so every job touches only its own layer
+        mPool.run(mLayers.size(), [this](std::size_t index) {
+            auto *layer = mLayers[index];
+            if (mCameraShared) layer->updateCamera(mCameraProjectionMatrix, mCameraViewMatrix, mCameraPosition);
+            layer->calculate();
+        });
+    }
+
+    DllExport KCore::LayerGroup *CreateLayerGroup
+            (int threads) {
+        return new KCore::LayerGroup(threads);
+    }
+
+    DllExport void DestroyLayerGroup
+            (KCore::LayerGroup *group_ptr) {
+        delete group_ptr;
+    }
+
+    DllExport void AddLayerToGroup
+            (KCore::LayerGroup *group_ptr, KCore::LayerInterface *layer_ptr) {
+        group_ptr->addLayer(layer_ptr);
+    }
+
+    DllExport void RemoveLayerFromGroup
+            (KCore::LayerGroup *group_ptr, KCore::LayerInterface *layer_ptr) {
+        group_ptr->removeLayer(layer_ptr);
+    }
+
+    DllExport void UpdateGroup
+            (KCore::LayerGroup *group_ptr,
+             float *projectionMatrix_ptr, float *viewMatrix_ptr,
+             bool projectionMatrixTranspose, bool viewMatrixTranspose) {
+        group_ptr->update(
+                projectionMatrix_ptr, viewMatrix_ptr,
+                projectionMatrixTranspose, viewMatrixTranspose
+        );
+    }
+
+    DllExport void CalculateGroup
+            (KCore::LayerGroup *group_ptr) {
+        group_ptr->calculate();
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+
+#include "LayerInterface.hpp"
+#include "../misc/WorkerPool.hpp"
+
+namespace KCore {
+    /** Set of layers calculated together on one fixed worker pool.
+     * Layers stay owned by the caller. Camera set on the group is shared by all
+     * members, otherwise every layer keeps the camera it was updated with.
+     **/
+    class LayerGroup {
+    private:
+        std::vector<LayerInterface *> mLayers{};
+
+        glm::mat4 mCameraViewMatrix{}, mCameraProjectionMatrix{};
+        glm::vec3 mCameraPosition{};
+        bool mCameraShared{false};
+
+        WorkerPool mPool;
+
+    public:
+        explicit LayerGroup
+                (int threads = 0);
+
+        void addLayer
+                (LayerInterface *layer);
+
+        void removeLayer
+                (LayerInterface *layer);
+
+        void update
+                (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix);
+
+        void update
+                (const float *projectionMatrix_ptr, const float *viewMatrix_ptr,
+                 bool transposeProjectionMatrix = false, bool transposeViewMatrix = false);
+
+        void calculate();
+    };
+
+    extern "C" {
+    DllExport KCore::LayerGroup *CreateLayerGroup
+            (int threads);
+    DllExport void DestroyLayerGroup
+            (KCore::LayerGroup *group_ptr);
+
+    DllExport void AddLayerToGroup
+            (KCore::LayerGroup *group_ptr, KCore::LayerInterface *layer_ptr);
+    DllExport void RemoveLayerFromGroup
+            (KCore::LayerGroup *group_ptr, KCore::LayerInterface *layer_ptr);
+
+    DllExport void UpdateGroup
+            (KCore::LayerGroup *group_ptr,
+             float *projectionMatrix_ptr, float *viewMatrix_ptr,
+             bool projectionMatrixTranspose = false, bool viewMatrixTranspose = false);
+
+    DllExport void CalculateGroup
+            (KCore::LayerGroup *group_ptr);
+    }
+}
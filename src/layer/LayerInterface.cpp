@@ -1,5 +1,7 @@
 #include "LayerInterface.hpp"
 
+#include <cmath>
+
 #include <glm/gtc/type_ptr.hpp>
 
 namespace KCore {
@@ -31,6 +33,8 @@ namespace KCore {
         mCameraViewMatrix = viewMatrix;
         auto invViewMatrix = glm::inverse(viewMatrix);
         mCameraPosition = invViewMatrix[3];
+
+        sampleVelocity();
     }
 
     void LayerInterface::updateViewMatrix
@@ -71,29 +75,177 @@ namespace KCore {
         updateViewMatrix(viewMatrix);
     }
 
+    void LayerInterface::updateCamera
+            (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const glm::vec3 &position) {
+        mCameraProjectionMatrix = projectionMatrix;
+        mCameraViewMatrix = viewMatrix;
+        mCameraPosition = position;
+
+        sampleVelocity();
+    }
+
     void LayerInterface::calculate() {
         performUpdate();
     }
 
     void LayerInterface::performUpdate() {
+        // budgeted refinement, transitions held by dwell time and new layer config keep going on the same camera
+        const auto &stats = mLayer.getStats();
+        if (!cameraChanged() && !mLayer.isConfigChanged() &&
+            stats.refinementsDeferred == 0 && stats.transitionsHeld == 0) {
+            mLayer.skipFrame();
+            return;
+        }
+
+        // sub-epsilon moves keep the old position, so cached tile errors stay valid on rotation
+        auto positionMoved = !mCameraApplied;
+        for (int i = 0; i < 3; i++)
+            positionMoved |= std::abs(mCameraPosition[i] - mAppliedPosition[i]) > mCameraEpsilon;
+        if (positionMoved) mAppliedPosition = mCameraPosition;
+
+        mAppliedViewMatrix = mCameraViewMatrix;
+        mAppliedProjectionMatrix = mCameraProjectionMatrix;
+        mCameraApplied = true;
+
         // !TODO: to parameter
-        mCameraProjectionMatrix *= glm::scale(glm::vec3{0.85f, 0.85f, 1.0f});
+        auto projectionMatrix = mCameraProjectionMatrix * glm::scale(glm::vec3{0.85f, 0.85f, 1.0f});
 
-        mLayer.updateFrustum(mCameraProjectionMatrix, mCameraViewMatrix);
-        mLayer.setPosition(mCameraPosition);
+        mLayer.updateFrustum(projectionMatrix, mCameraViewMatrix);
+        mLayer.setPosition(mAppliedPosition);
         mLayer.update();
+
+        if (mPrefetchLookahead > 0.0f) prefetchAhead(projectionMatrix);
+    }
+
+    void LayerInterface::sampleVelocity() {
+        auto now = std::chrono::steady_clock::now();
+
+        if (!mVelocitySampled) {
+            mVelocitySamplePosition = mCameraPosition;
+            mVelocitySampleTime = now;
+            mVelocitySampled = true;
+            return;
+        }
+
+        // several updates within one frame would give noise, they're measured together
+        std::chrono::duration<float> elapsed = now - mVelocitySampleTime;
+        if (elapsed.count() < 1e-3f) return;
+
+        auto velocity = (mCameraPosition - mVelocitySamplePosition) / elapsed.count();
+        mCameraVelocity = glm::mix(mCameraVelocity, velocity, 0.5f);
+
+        mVelocitySamplePosition = mCameraPosition;
+        mVelocitySampleTime = now;
+    }
+
+    void LayerInterface::prefetchAhead
+            (const glm::mat4 &projectionMatrix) {
+        auto offset = mCameraVelocity * mPrefetchLookahead;
+        if (glm::length(offset) <= mCameraEpsilon) return;
+
+        // same orientation, camera moved along its velocity
+        auto viewMatrix = mCameraViewMatrix * glm::translate(-offset);
+        mLayer.prefetch(projectionMatrix, viewMatrix, mAppliedPosition + offset);
+    }
+
+    void LayerInterface::setPrefetchLookahead
+            (float seconds) {
+        mPrefetchLookahead = seconds;
+    }
+
+    bool LayerInterface::cameraChanged() const {
+        if (!mCameraApplied) return true;
+
+        for (int col = 0; col < 4; col++) {
+            for (int row = 0; row < 4; row++) {
+                if (std::abs(mCameraViewMatrix[col][row] - mAppliedViewMatrix[col][row]) > mCameraEpsilon ||
+                    std::abs(mCameraProjectionMatrix[col][row] - mAppliedProjectionMatrix[col][row]) > mCameraEpsilon)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void LayerInterface::setCameraEpsilon
+            (float epsilon) {
+        mCameraEpsilon = epsilon;
+    }
+
+    void LayerInterface::setSubdivisionThreads
+            (int threads) {
+        mLayer.setSubdivisionThreads(threads);
+    }
+
+    void LayerInterface::setRefinementBudget
+            (int nodes, float milliseconds) {
+        mLayer.setRefinementBudget(nodes > 0 ? nodes : 0, milliseconds);
+    }
+
+    void LayerInterface::setLodHysteresis
+            (float splitFactor, float mergeFactor, float minDwellTime) {
+        mLayer.setLodHysteresis(splitFactor, mergeFactor, minDwellTime);
+    }
+
+    void LayerInterface::setVisibleTilesCap
+            (int cap) {
+        mLayer.setVisibleTilesCap(cap > 0 ? cap : 0);
+    }
+
+    void LayerInterface::setElevationSource
+            (IElevationSource *source) {
+        mLayer.setElevationSource(source);
+    }
+
+    const LayerStats &LayerInterface::getStats() const {
+        return mLayer.getStats();
     }
 
     std::vector<LayerEvent> LayerInterface::getCoreEvents() {
-        auto res = mLayer.getCoreEventsCopyAndClearQueue();
+        auto res = mLayer.drainCoreEvents();
         return res;
     }
 
     std::vector<LayerEvent> LayerInterface::getImageEvents() {
-        auto res = mLayer.getImageEventsCopyAndClearQueue();
+        auto res = mLayer.drainImageEvents();
         return res;
     }
 
+    int LayerInterface::drainCoreEvents
+            (LayerEvent *out, int capacity) {
+        if (out == nullptr || capacity <= 0) return 0;
+        return (int) mLayer.drainCoreEvents(out, (std::size_t) capacity);
+    }
+
+    int LayerInterface::drainImageEvents
+            (LayerEvent *out, int capacity) {
+        if (out == nullptr || capacity <= 0) return 0;
+        return (int) mLayer.drainImageEvents(out, (std::size_t) capacity);
+    }
+
+    void LayerInterface::setEventCallback
+            (int type, LayerEventCallback callback, void *context) {
+        mLayer.setEventCallback((LayerEventType) type, callback, context);
+    }
+
+    void LayerInterface::setEventDeliveryThread
+            (bool enabled) {
+        mLayer.setEventDeliveryThread(enabled);
+    }
+
+    int LayerInterface::dispatchEvents() {
+        return (int) mLayer.dispatchEvents();
+    }
+
+    void LayerInterface::setNetworkThreads
+            (int threads) {
+        mLayer.setNetworkThreads(threads);
+    }
+
+    void LayerInterface::setRequestsPerFrame
+            (int requests) {
+        mLayer.setRequestsPerFrame(requests > 0 ? requests : 0);
+    }
+
     void LayerInterface::setLayerRasterUrl
             (const char *url) {
         mLayer.setRasterUrl(url);
@@ -176,16 +328,97 @@ namespace KCore {
         return vector_ptr->data();
     }
 
-    DllExport void ReleaseEventsVector
-            (std::vector<LayerEvent> *vector_ptr) {
-        for (const auto &item: *vector_ptr) {
+    DllExport void SetCameraEpsilon
+            (KCore::LayerInterface *layer_ptr, float epsilon) {
+        layer_ptr->setCameraEpsilon(epsilon);
+    }
+
+    DllExport void SetLayerSubdivisionThreads
+            (KCore::LayerInterface *layer_ptr, int threads) {
+        layer_ptr->setSubdivisionThreads(threads);
+    }
+
+    DllExport void SetLayerRefinementBudget
+            (KCore::LayerInterface *layer_ptr, int nodes, float milliseconds) {
+        layer_ptr->setRefinementBudget(nodes, milliseconds);
+    }
+
+    DllExport void SetLayerPrefetchLookahead
+            (KCore::LayerInterface *layer_ptr, float seconds) {
+        layer_ptr->setPrefetchLookahead(seconds);
+    }
+
+    DllExport void SetLayerLodHysteresis
+            (KCore::LayerInterface *layer_ptr, float splitFactor, float mergeFactor, float minDwellTime) {
+        layer_ptr->setLodHysteresis(splitFactor, mergeFactor, minDwellTime);
+    }
+
+    DllExport void SetLayerVisibleTilesCap
+            (KCore::LayerInterface *layer_ptr, int cap) {
+        layer_ptr->setVisibleTilesCap(cap);
+    }
+
+    DllExport void SetLayerElevationSource
+            (KCore::LayerInterface *layer_ptr, KCore::IElevationSource *source_ptr) {
+        layer_ptr->setElevationSource(source_ptr);
+    }
+
+    DllExport void GetLayerStats
+            (KCore::LayerInterface *layer_ptr, LayerStats &stats) {
+        stats = layer_ptr->getStats();
+    }
+
+    DllExport int DrainCoreEvents
+            (KCore::LayerInterface *layer_ptr, LayerEvent *out, int capacity) {
+        return layer_ptr->drainCoreEvents(out, capacity);
+    }
+
+    DllExport int DrainImageEvents
+            (KCore::LayerInterface *layer_ptr, LayerEvent *out, int capacity) {
+        return layer_ptr->drainImageEvents(out, capacity);
+    }
+
+    DllExport void ReleaseEvents
+            (LayerEvent *events, int count) {
+        for (int i = 0; i < count; i++) {
+            auto &item = events[i];
+
+            // tile payloads are inline, only pixels live outside of event
             if (item.type == ImageReady) {
-                auto *castedPayload = (ImagePayloadEvent *) item.payload;
-                delete[] castedPayload->data;
-                delete castedPayload;
+                STBImageUtils::releaseImageBuffer(item.payload.image.data);
+                item.payload.image.data = nullptr;
             }
         }
+    }
+
+    DllExport void SetLayerEventCallback
+            (KCore::LayerInterface *layer_ptr, int type, LayerEventCallback callback, void *context) {
+        layer_ptr->setEventCallback(type, callback, context);
+    }
 
+    DllExport void SetLayerEventDeliveryThread
+            (KCore::LayerInterface *layer_ptr, bool enabled) {
+        layer_ptr->setEventDeliveryThread(enabled);
+    }
+
+    DllExport int DispatchLayerEvents
+            (KCore::LayerInterface *layer_ptr) {
+        return layer_ptr->dispatchEvents();
+    }
+
+    DllExport void SetLayerNetworkThreads
+            (KCore::LayerInterface *layer_ptr, int threads) {
+        layer_ptr->setNetworkThreads(threads);
+    }
+
+    DllExport void SetLayerRequestsPerFrame
+            (KCore::LayerInterface *layer_ptr, int requests) {
+        layer_ptr->setRequestsPerFrame(requests);
+    }
+
+    DllExport void ReleaseEventsVector
+            (std::vector<LayerEvent> *vector_ptr) {
+        ReleaseEvents(vector_ptr->data(), (int) vector_ptr->size());
         delete vector_ptr;
     }
 }
\ No newline at end of file
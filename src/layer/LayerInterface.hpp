@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "glm/glm.hpp"
 
 #include "Layer.hpp"
@@ -10,6 +12,18 @@ namespace KCore {
         glm::mat4 mCameraViewMatrix{}, mCameraProjectionMatrix{};
         glm::vec3 mCameraPosition{};
 
+        // camera of the last calculated frame, calculate() is a no-op until it changes
+        glm::mat4 mAppliedViewMatrix{}, mAppliedProjectionMatrix{};
+        glm::vec3 mAppliedPosition{};
+        bool mCameraApplied{false};
+        float mCameraEpsilon{1e-6f};
+
+        // camera velocity in world units per second, measured between view matrix updates
+        glm::vec3 mCameraVelocity{}, mVelocitySamplePosition{};
+        std::chrono::steady_clock::time_point mVelocitySampleTime{};
+        bool mVelocitySampled{false};
+        float mPrefetchLookahead{0.0f};
+
         Layer mLayer;
 
     public:
@@ -49,12 +63,59 @@ namespace KCore {
                 (const float *projectionMatrix_ptr, const float *viewMatrix_ptr,
                  bool transposeProjectionMatrix = false, bool transposeViewMatrix = false);
 
+        // camera with already known position, lets callers share one inverse between layers
+        void updateCamera
+                (const glm::mat4 &projectionMatrix, const glm::mat4 &viewMatrix, const glm::vec3 &position);
+
         void calculate();
 
         std::vector<LayerEvent> getCoreEvents();
 
         std::vector<LayerEvent> getImageEvents();
 
+        int drainCoreEvents
+                (LayerEvent *out, int capacity);
+
+        int drainImageEvents
+                (LayerEvent *out, int capacity);
+
+        void setEventCallback
+                (int type, LayerEventCallback callback, void *context);
+
+        void setEventDeliveryThread
+                (bool enabled);
+
+        int dispatchEvents();
+
+        void setNetworkThreads
+                (int threads);
+
+        void setRequestsPerFrame
+                (int requests);
+
+        void setCameraEpsilon
+                (float epsilon);
+
+        void setSubdivisionThreads
+                (int threads);
+
+        void setRefinementBudget
+                (int nodes, float milliseconds);
+
+        void setPrefetchLookahead
+                (float seconds);
+
+        void setLodHysteresis
+                (float splitFactor, float mergeFactor, float minDwellTime);
+
+        void setVisibleTilesCap
+                (int cap);
+
+        void setElevationSource
+                (IElevationSource *source);
+
+        [[nodiscard]] const LayerStats &getStats() const;
+
         Layer *raw();
 
     private:
@@ -62,6 +123,13 @@ namespace KCore {
                 (const char *url);
 
         void performUpdate();
+
+        [[nodiscard]] bool cameraChanged() const;
+
+        void sampleVelocity();
+
+        void prefetchAhead
+                (const glm::mat4 &projectionMatrix);
     };
 
     extern "C" {
@@ -101,7 +169,43 @@ namespace KCore {
     DllExport void ReleaseEventsVector
             (std::vector<LayerEvent> *vector_ptr);
 
+    DllExport int DrainCoreEvents
+            (KCore::LayerInterface *layer_ptr, LayerEvent *out, int capacity);
+    DllExport int DrainImageEvents
+            (KCore::LayerInterface *layer_ptr, LayerEvent *out, int capacity);
+    DllExport void ReleaseEvents
+            (LayerEvent *events, int count);
+
+    DllExport void SetLayerEventCallback
+            (KCore::LayerInterface *layer_ptr, int type, LayerEventCallback callback, void *context);
+    DllExport void SetLayerEventDeliveryThread
+            (KCore::LayerInterface *layer_ptr, bool enabled);
+    DllExport int DispatchLayerEvents
+            (KCore::LayerInterface *layer_ptr);
+
+    DllExport void SetLayerNetworkThreads
+            (KCore::LayerInterface *layer_ptr, int threads);
+    DllExport void SetLayerRequestsPerFrame
+            (KCore::LayerInterface *layer_ptr, int requests);
+
     DllExport void SetLayerRasterUrl
             (KCore::LayerInterface *layer_ptr, const char *url);
+
+    DllExport void SetCameraEpsilon
+            (KCore::LayerInterface *layer_ptr, float epsilon);
+    DllExport void SetLayerSubdivisionThreads
+            (KCore::LayerInterface *layer_ptr, int threads);
+    DllExport void SetLayerRefinementBudget
+            (KCore::LayerInterface *layer_ptr, int nodes, float milliseconds);
+    DllExport void SetLayerPrefetchLookahead
+            (KCore::LayerInterface *layer_ptr, float seconds);
+    DllExport void SetLayerLodHysteresis
+            (KCore::LayerInterface *layer_ptr, float splitFactor, float mergeFactor, float minDwellTime);
+    DllExport void SetLayerVisibleTilesCap
+            (KCore::LayerInterface *layer_ptr, int cap);
+    DllExport void SetLayerElevationSource
+            (KCore::LayerInterface *layer_ptr, KCore::IElevationSource *source_ptr);
+    DllExport void GetLayerStats
+            (KCore::LayerInterface *layer_ptr, LayerStats &stats);
     }
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+namespace KCore {
+    struct LayerStats {
+        /* 00..08         bytes */
+        uint64_t framesCalculated{0};
+        /* 08..16         bytes */
+        uint64_t framesSkipped{0};
+        /* 16..24         bytes */
+        uint64_t framesRevalidated{0};
+        /* 24..28         bytes */
+        uint32_t visibleTiles{0};
+        /* 28..32         bytes */
+        uint32_t nodesVisited{0};
+        /* 32..36         bytes */
+        uint32_t refinementsDeferred{0};
+        /* 36..40         bytes */
+        uint32_t tilesPrefetched{0};
+        /* 40..44         bytes */
+        uint32_t tilesCapped{0};
+        /* 44..48         bytes */
+        uint32_t requestsStarted{0};
+        /* 48..52         bytes */
+        uint32_t requestsPending{0};
+        /* 52..56         bytes */
+        uint32_t transitionsHeld{0};
+    };
+}
@@ -1,5 +1,8 @@
 #include "RemoteSource.hpp"
 
+#include <charconv>
+#include <system_error>
+
 namespace KCore {
     RemoteSource::RemoteSource
             (std::string rawUrl) : mRawUrl(std::move(rawUrl)) {
@@ -12,9 +15,29 @@ namespace KCore {
         restoreRawUrl();
     }
 
-    std::string RemoteSource::bakeUrl
-    (const TileDescription &desc) {
-        return mURLPrefix + desc.createTileURL() + mURLSuffix;
+    RequestUrl RemoteSource::bakeUrl
+            (const TileDescription &desc) const {
+        // "{z}/{x}/{y}" is written in place, the url is baked into a fixed buffer
+        const auto &tilecode = desc.getTilecode();
+        const int numbers[3] = {tilecode.z, tilecode.x, tilecode.y};
+
+        char code[NUMBER_LENGTH * 3];
+        auto *end = code;
+        for (int i = 0; i < 3; i++) {
+            auto [ptr, ec] = std::to_chars(end, code + sizeof(code), numbers[i]);
+            if (ec != std::errc{}) return RequestUrl{mRawUrl};
+
+            end = ptr;
+            if (i < 2) *end++ = '/';
+        }
+
+        RequestUrl url;
+        url.append(mURLPrefix).append({code, (std::size_t) (end - code)}).append(mURLSuffix);
+        return url;
+    }
+
+    bool RemoteSource::fitsRequestUrl() const {
+        return mURLPrefix.size() + NUMBER_LENGTH * 3 + mURLSuffix.size() <= RequestUrl::CAPACITY;
     }
 
     void RemoteSource::restoreRawUrl() {
@@ -2,16 +2,21 @@
 
 #include <cstdint>
 #include <fstream>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "../geography/TileDescription.hpp"
 #include "../misc/Bindings.hpp"
+#include "../network/RequestUrl.hpp"
 
 namespace KCore {
     class RemoteSource {
     private:
+        // digits10 is one less than the longest int, plus the sign and a separator per number
+        constexpr static int NUMBER_LENGTH = std::numeric_limits<int>::digits10 + 3;
+
         std::string mRawUrl;
         std::string mURLPrefix, mURLSuffix;
 
@@ -30,8 +35,11 @@ namespace KCore {
         RemoteSource
                 (std::string prefix, std::string affix);
 
-        std::string bakeUrl
-                (const TileDescription &desc);
+        [[nodiscard]] RequestUrl bakeUrl
+                (const TileDescription &desc) const;
+
+        // url of any tile fits into RequestUrl
+        [[nodiscard]] bool fitsRequestUrl() const;
 
     private:
         void restoreRawUrl();
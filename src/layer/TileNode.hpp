@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "../geography/TileDescription.hpp"
+
+namespace KCore {
+    class Layer;
+
+    struct TileNode {
+        TileDescription description;
+        // four siblings in a row, taken from the layer's node pool
+        TileNode *children{nullptr};
+
+        // screen space error and the camera position generation it was computed for
+        float error{0.0f};
+        uint64_t errorGeneration{0};
+
+        // frame time of the last split or merge by level of detail, min means never
+        std::chrono::steady_clock::time_point changedAt{std::chrono::steady_clock::time_point::min()};
+
+        // nodes visited in this subtree last frame, tells how much work it is worth
+        uint32_t subtreeNodes{0};
+
+        TileNode() = default;
+
+        TileNode
+                (const Layer *layer, TileKey key) : description(layer, key) {}
+
+        [[nodiscard]] bool isSeparated() const {
+            return children != nullptr;
+        }
+    };
+}
@@ -0,0 +1,33 @@
+#include "TileNodePool.hpp"
+
+namespace KCore {
+    TileNode *TileNodePool::acquire() {
+        std::lock_guard<std::mutex> lock{mLock};
+
+        if (!mFree.empty()) {
+            auto *block = mFree.back();
+            mFree.pop_back();
+            return block;
+        }
+
+        if (mChunkUsed == CHUNK_BLOCKS) {
+            mChunks.push_back(std::make_unique<TileNode[]>(CHUNK_BLOCKS * 4));
+            // every block may end up in free list at once, so it never has to grow on release
+            mFree.reserve(mChunks.size() * CHUNK_BLOCKS);
+            mChunkUsed = 0;
+        }
+
+        return &mChunks.back()[4 * mChunkUsed++];
+    }
+
+    void TileNodePool::release
+            (TileNode *siblings) {
+        std::lock_guard<std::mutex> lock{mLock};
+
+        mFree.push_back(siblings);
+    }
+
+    std::size_t TileNodePool::getCapacity() const {
+        return mChunks.size() * CHUNK_BLOCKS * 4;
+    }
+}
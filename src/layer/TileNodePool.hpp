@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TileNode.hpp"
+
+namespace KCore {
+    /** Storage of quadtree nodes with stable addresses.
+     * Siblings are always created and dropped together, so the pool hands out
+     * blocks of four nodes. Blocks come from chunks that are never freed while
+     * the pool lives and go back to a free list, so a tree that stopped growing
+     * doesn't touch the heap anymore. Access is locked for parallel subdivision.
+     **/
+    class TileNodePool {
+    private:
+        constexpr static std::size_t CHUNK_BLOCKS = 256;
+
+        std::vector<std::unique_ptr<TileNode[]>> mChunks{};
+        std::size_t mChunkUsed{CHUNK_BLOCKS};
+
+        // first nodes of free blocks
+        std::vector<TileNode *> mFree{};
+        std::mutex mLock;
+
+    public:
+        // first of four consecutive nodes, their content is left from previous owner
+        TileNode *acquire();
+
+        void release
+                (TileNode *siblings);
+
+        [[nodiscard]] std::size_t getCapacity() const;
+    };
+}
@@ -0,0 +1,40 @@
+#include "TileSetDiff.hpp"
+
+namespace KCore {
+    void TileSetDiff::compute
+            (std::span<const TileDescription> previous, std::span<const TileDescription> current) {
+        mAdded.clear();
+        mRemoved.clear();
+        mKept.clear();
+
+        std::size_t i = 0, j = 0;
+        while (i < previous.size() && j < current.size()) {
+            auto prevKey = previous[i].getKey();
+            auto currKey = current[j].getKey();
+
+            if (prevKey == currKey) {
+                mKept.push_back(j);
+                i++, j++;
+            } else if (TileKey::traversalLess(prevKey, currKey)) {
+                mRemoved.push_back(i++);
+            } else {
+                mAdded.push_back(j++);
+            }
+        }
+
+        for (; i < previous.size(); i++) mRemoved.push_back(i);
+        for (; j < current.size(); j++) mAdded.push_back(j);
+    }
+
+    const std::vector<std::size_t> &TileSetDiff::getAdded() const {
+        return mAdded;
+    }
+
+    const std::vector<std::size_t> &TileSetDiff::getRemoved() const {
+        return mRemoved;
+    }
+
+    const std::vector<std::size_t> &TileSetDiff::getKept() const {
+        return mKept;
+    }
+}
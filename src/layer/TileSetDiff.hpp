@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "../geography/TileDescription.hpp"
+
+namespace KCore {
+    /** Difference between two visible tile sets of consecutive frames.
+     * Both sets have to be sorted with TileKey::traversalLess (the order in which
+     * the quadtree emits its leaves), so the difference is one merge-like pass.
+     * Results are indices into the compared sets, buffers are reused between frames.
+     **/
+    class TileSetDiff {
+    private:
+        std::vector<std::size_t> mAdded, mRemoved, mKept;
+
+    public:
+        void compute
+                (std::span<const TileDescription> previous, std::span<const TileDescription> current);
+
+        // indices into current set
+        [[nodiscard]] const std::vector<std::size_t> &getAdded() const;
+
+        // indices into previous set
+        [[nodiscard]] const std::vector<std::size_t> &getRemoved() const;
+
+        // indices into current set
+        [[nodiscard]] const std::vector<std::size_t> &getKept() const;
+    };
+}
@@ -5,11 +5,18 @@ namespace KCore {
     ImagePayloadEvent::ImagePayloadEvent
             (const std::vector<uint8_t> &rawResult) {
         int w = -1, h = -1, ch = -1;
-        auto result = STBImageUtils::decodeImageBuffer(rawResult.data(), rawResult.size(), w, h, ch);
+        auto *pixels = STBImageUtils::decodeImageBuffer(rawResult.data(), rawResult.size(), w, h, ch);
 
-        setWidthHeight(w, h);
-        setFormat(ch);
-        setData(result);
+        try {
+            setWidthHeight(w, h);
+            setFormat(ch);
+        } catch (...) {
+            STBImageUtils::releaseImageBuffer(pixels);
+            throw;
+        }
+
+        // decoder output is the final buffer, it goes to the host as is
+        setData(pixels, (uint64_t) w * h * ch);
     }
 
     void ImagePayloadEvent::setWidthHeight
@@ -36,10 +43,9 @@ namespace KCore {
     }
 
     void ImagePayloadEvent::setData
-            (const std::vector<uint8_t> &result) {
-        size = result.size();
-        data = new uint8_t[size];
-        std::copy(result.begin(), result.end(), data);
+            (uint8_t *pixels, uint64_t length) {
+        size = length;
+        data = pixels;
     }
 
     TilePayloadEvent::TilePayloadEvent
@@ -49,7 +55,7 @@ namespace KCore {
         setScale(description);
         setType(description);
         setVisibility(description);
-        setQuadcode(description);
+        setTilekey(description);
     }
 
     void TilePayloadEvent::setTilecode
@@ -77,12 +83,8 @@ namespace KCore {
         visibility = description.getVisibility();
     }
 
-    void TilePayloadEvent::setQuadcode
+    void TilePayloadEvent::setTilekey
             (const TileDescription &description) {
-#if defined(_MSC_VER)
-        strcpy_s(quadcode, description.getQuadcode().c_str());
-#elif defined(__GNUC__)
-        strcpy(quadcode, description.getQuadcode().c_str());
-#endif
+        tilekey = description.getKey().value;
     }
 }
\ No newline at end of file
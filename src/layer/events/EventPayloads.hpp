@@ -18,12 +18,14 @@ namespace KCore {
         uint32_t width{0}, height{0};
         /* 08..12         bytes */
         ImageFormat format{};
-        /* 12..20         bytes */
+        /* 16..24         bytes */
         uint64_t size{0};
-        /* 20..28         bytes */
+        /* 24..32         bytes */
         uint8_t *data{nullptr};
 
     public:
+        ImagePayloadEvent() = default;
+
         explicit ImagePayloadEvent
                 (const std::vector<uint8_t> &rawResult);
 
@@ -35,7 +37,7 @@ namespace KCore {
                 (const int &channels);
 
         void setData
-                (const std::vector<uint8_t> &result);
+                (uint8_t *pixels, uint64_t length);
     };
 
     struct TilePayloadEvent {
@@ -49,10 +51,12 @@ namespace KCore {
         TileType type{Leaf};
         /* 28..32         bytes */
         TileVisibility visibility{Visible};
-        /* 32..64         bytes */
-        char quadcode[32]{};
+        /* 32..40         bytes */
+        uint64_t tilekey{0};
 
     public:
+        TilePayloadEvent() = default;
+
         explicit TilePayloadEvent
                 (const TileDescription &description);
 
@@ -72,7 +76,7 @@ namespace KCore {
         void setVisibility
                 (const TileDescription &description);
 
-        void setQuadcode
+        void setTilekey
                 (const TileDescription &description);
     };
-}
\ No newline at end of file
+}
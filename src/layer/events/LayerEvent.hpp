@@ -1,8 +1,7 @@
 #pragma once
 
-#include <cstring>
-
 #include "../../geography/TileDescription.hpp"
+#include "../../geography/TileKey.hpp"
 #include "EventPayloads.hpp"
 
 namespace KCore {
@@ -12,18 +11,34 @@ namespace KCore {
         ImageReady = 2
     };
 
+    // payload is stored inline, its active member is chosen by event type
+    union LayerEventPayload {
+        /* 00..40         bytes */
+        TilePayloadEvent tile;
+        /* 00..32         bytes */
+        ImagePayloadEvent image;
+
+        LayerEventPayload() : tile{} {}
+    };
+
     struct LayerEvent {
-        LayerEventType type;
-        char quadcode[32];
-        void *payload;
+        /* 00..04         bytes */
+        LayerEventType type{NotInFrustum};
+        /* 08..16         bytes */
+        uint64_t tilekey{0};
+        /* 16..56         bytes */
+        LayerEventPayload payload{};
 
         static LayerEvent MakeInFrustumEvent
-                (const std::string &quadcode, const TileDescription &description);
+                (TileKey key, const TileDescription &description);
 
         static LayerEvent MakeNotInFrustumEvent
-                (const std::string &quadcode);
+                (TileKey key);
 
         static LayerEvent MakeImageEvent
-                (const std::string &quadcode, const std::vector<uint8_t> &result);
+                (TileKey key, const std::vector<uint8_t> &result);
     };
+
+    // host function receiving batch of events of one type, context is passed through as it was registered
+    typedef void (*LayerEventCallback)(void *context, const LayerEvent *events, int count);
 }
\ No newline at end of file
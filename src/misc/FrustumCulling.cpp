@@ -0,0 +1,203 @@
+#include "FrustumCulling.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KCORE_CULLING_X86
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define KCORE_TARGET_SSE
+#define KCORE_TARGET_AVX2
+#else
+#define KCORE_TARGET_SSE __attribute__((target("sse2")))
+#define KCORE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace KCore {
+    namespace {
+        // per tested plane: box corner arrays with the greatest (far) and the least (near) signed distance
+        struct PlaneSelection {
+            int planes[6];
+            int count;
+
+            const float *farX[6], *farY[6], *farZ[6];
+            const float *nearX[6], *nearY[6], *nearZ[6];
+        };
+
+        PlaneSelection selectCorners
+                (const float (&planes)[6][4], const AABBBatch &boxes, uint8_t planeMask) {
+            const float *x[2] = {boxes.maxX, boxes.minX};
+            const float *y[2] = {boxes.maxY, boxes.minY};
+            const float *z[2] = {boxes.maxZ, boxes.minZ};
+
+            PlaneSelection selection;
+            selection.count = 0;
+
+            for (int p = 0; p < 6; p++) {
+                if (!(planeMask & (1 << p))) continue;
+
+                bool sx = planes[p][0] < 0, sy = planes[p][1] < 0, sz = planes[p][2] < 0;
+
+                auto n = selection.count++;
+                selection.planes[n] = p;
+                selection.farX[n] = x[sx], selection.nearX[n] = x[!sx];
+                selection.farY[n] = y[sy], selection.nearY[n] = y[!sy];
+                selection.farZ[n] = z[sz], selection.nearZ[n] = z[!sz];
+            }
+            return selection;
+        }
+
+        void cullScalar
+                (const float (&planes)[6][4], const PlaneSelection &corners,
+                 std::size_t begin, std::size_t end, uint8_t *results) {
+            for (auto i = begin; i < end; i++) {
+                uint8_t straddles = 0;
+
+                for (int n = 0; n < corners.count; n++) {
+                    const auto &plane = planes[corners.planes[n]];
+
+                    auto far = plane[0] * corners.farX[n][i] +
+                               plane[1] * corners.farY[n][i] +
+                               plane[2] * corners.farZ[n][i];
+                    if (!(far >= -plane[3])) {
+                        straddles = FrustumCulling::OUTSIDE;
+                        break;
+                    }
+
+                    auto near = plane[0] * corners.nearX[n][i] +
+                                plane[1] * corners.nearY[n][i] +
+                                plane[2] * corners.nearZ[n][i];
+                    if (near < -plane[3]) straddles |= 1 << corners.planes[n];
+                }
+
+                results[i] = straddles;
+            }
+        }
+
+#ifdef KCORE_CULLING_X86
+        KCORE_TARGET_SSE std::size_t cullSSE
+                (const float (&planes)[6][4], const PlaneSelection &corners,
+                 std::size_t begin, std::size_t end, uint8_t *results) {
+            auto i = begin;
+            for (; i + 4 <= end; i += 4) {
+                auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                auto straddles = _mm_setzero_si128();
+
+                for (int n = 0; n < corners.count; n++) {
+                    const auto &plane = planes[corners.planes[n]];
+                    auto a = _mm_set1_ps(plane[0]), b = _mm_set1_ps(plane[1]), c = _mm_set1_ps(plane[2]);
+                    auto w = _mm_set1_ps(-plane[3]);
+
+                    auto far = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(corners.farX[n] + i)),
+                                                     _mm_mul_ps(b, _mm_loadu_ps(corners.farY[n] + i))),
+                                          _mm_mul_ps(c, _mm_loadu_ps(corners.farZ[n] + i)));
+                    auto near = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, _mm_loadu_ps(corners.nearX[n] + i)),
+                                                      _mm_mul_ps(b, _mm_loadu_ps(corners.nearY[n] + i))),
+                                           _mm_mul_ps(c, _mm_loadu_ps(corners.nearZ[n] + i)));
+
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(far, w));
+
+                    auto straddle = _mm_castps_si128(_mm_cmplt_ps(near, w));
+                    straddles = _mm_or_si128(straddles,
+                                             _mm_and_si128(straddle, _mm_set1_epi32(1 << corners.planes[n])));
+                }
+
+                // lanes outside get OUTSIDE, then 32-bit lanes are narrowed down to bytes
+                auto outside = _mm_andnot_si128(_mm_castps_si128(inside), _mm_set1_epi32(FrustumCulling::OUTSIDE));
+                auto lanes = _mm_or_si128(_mm_and_si128(_mm_castps_si128(inside), straddles), outside);
+                lanes = _mm_packs_epi32(lanes, lanes);
+                lanes = _mm_packus_epi16(lanes, lanes);
+
+                auto packed = _mm_cvtsi128_si32(lanes);
+                std::memcpy(results + i, &packed, 4);
+            }
+            return i;
+        }
+
+        KCORE_TARGET_AVX2 std::size_t cullAVX2
+                (const float (&planes)[6][4], const PlaneSelection &corners,
+                 std::size_t begin, std::size_t end, uint8_t *results) {
+            auto i = begin;
+            for (; i + 8 <= end; i += 8) {
+                auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                auto straddles = _mm256_setzero_si256();
+
+                for (int n = 0; n < corners.count; n++) {
+                    const auto &plane = planes[corners.planes[n]];
+                    auto a = _mm256_set1_ps(plane[0]), b = _mm256_set1_ps(plane[1]), c = _mm256_set1_ps(plane[2]);
+                    auto w = _mm256_set1_ps(-plane[3]);
+
+                    auto far = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(corners.farX[n] + i)),
+                                                           _mm256_mul_ps(b, _mm256_loadu_ps(corners.farY[n] + i))),
+                                             _mm256_mul_ps(c, _mm256_loadu_ps(corners.farZ[n] + i)));
+                    auto near = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, _mm256_loadu_ps(corners.nearX[n] + i)),
+                                                            _mm256_mul_ps(b, _mm256_loadu_ps(corners.nearY[n] + i))),
+                                              _mm256_mul_ps(c, _mm256_loadu_ps(corners.nearZ[n] + i)));
+
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(far, w, _CMP_GE_OQ));
+
+                    auto straddle = _mm256_castps_si256(_mm256_cmp_ps(near, w, _CMP_LT_OQ));
+                    straddles = _mm256_or_si256(straddles,
+                                                _mm256_and_si256(straddle, _mm256_set1_epi32(1 << corners.planes[n])));
+                }
+
+                // lanes outside get OUTSIDE, then 32-bit lanes are narrowed down to bytes
+                auto insideLanes = _mm256_castps_si256(inside);
+                auto outside = _mm256_andnot_si256(insideLanes, _mm256_set1_epi32(FrustumCulling::OUTSIDE));
+                auto lanes = _mm256_or_si256(_mm256_and_si256(insideLanes, straddles), outside);
+
+                auto narrowed = _mm_packs_epi32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+                narrowed = _mm_packus_epi16(narrowed, narrowed);
+                _mm_storel_epi64((__m128i *) (results + i), narrowed);
+            }
+            return i;
+        }
+#endif
+
+        enum class CullingKernel {
+            Scalar,
+            SSE,
+            AVX2
+        };
+
+        CullingKernel detectKernel() {
+#if defined(KCORE_CULLING_X86) && defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            bool sse2 = info[3] & (1 << 26);
+            bool osAVX = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+
+            __cpuidex(info, 7, 0);
+            bool avx2 = osAVX && (info[1] & (1 << 5));
+
+            if (avx2) return CullingKernel::AVX2;
+            if (sse2) return CullingKernel::SSE;
+#elif defined(KCORE_CULLING_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) return CullingKernel::AVX2;
+            if (__builtin_cpu_supports("sse2")) return CullingKernel::SSE;
+#endif
+            return CullingKernel::Scalar;
+        }
+    }
+
+    void FrustumCulling::testAABBBatch
+            (const AABBBatch &boxes, uint8_t planeMask, uint8_t *results) const {
+        const static auto kernel = detectKernel();
+
+        auto corners = selectCorners(mPlanes, boxes, planeMask);
+
+        std::size_t done = 0;
+#ifdef KCORE_CULLING_X86
+        if (kernel == CullingKernel::AVX2 && boxes.count >= 8)
+            done = cullAVX2(mPlanes, corners, done, boxes.count, results);
+        if (kernel != CullingKernel::Scalar)
+            done = cullSSE(mPlanes, corners, done, boxes.count, results);
+#endif
+        cullScalar(mPlanes, corners, done, boxes.count, results);
+    }
+}
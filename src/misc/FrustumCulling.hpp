@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 
 #include "glm/glm.hpp"
@@ -9,6 +12,19 @@
 
 
 namespace KCore {
+    enum CullingState {
+        Outside = 0,
+        Intersects = 1,
+        Inside = 2
+    };
+
+    /** Boxes in struct-of-arrays layout, every array holds `count` values **/
+    struct AABBBatch {
+        const float *minX, *minY, *minZ;
+        const float *maxX, *maxY, *maxZ;
+        std::size_t count;
+    };
+
     class FrustumCulling {
     private:
         float nxX{}, nxY{}, nxZ{}, nxW{};
@@ -18,8 +34,16 @@ namespace KCore {
         float nzX{}, nzY{}, nzZ{}, nzW{};
         float pzX{}, pzY{}, pzZ{}, pzW{};
 
+        // same planes as above as (x, y, z, w) rows for the batch kernels
+        float mPlanes[6][4]{};
+
         glm::mat4 mProjectViewMatrix{};
     public:
+        // one bit per plane in order: nx, px, ny, py, nz, pz
+        constexpr static uint8_t ALL_PLANES = 0x3F;
+        // batch result of the box that is completely outside
+        constexpr static uint8_t OUTSIDE = 0x80;
+
         FrustumCulling() = default;
 
         void updateFrustum
@@ -55,6 +79,16 @@ namespace KCore {
             pzY = mProjectViewMatrix[1][3] - mProjectViewMatrix[1][2];
             pzZ = mProjectViewMatrix[2][3] - mProjectViewMatrix[2][2];
             pzW = mProjectViewMatrix[3][3] - mProjectViewMatrix[3][2];
+
+            const float planes[6][4] = {
+                    {nxX, nxY, nxZ, nxW},
+                    {pxX, pxY, pxZ, pxW},
+                    {nyX, nyY, nyZ, nyW},
+                    {pyX, pyY, pyZ, pyW},
+                    {nzX, nzY, nzZ, nzW},
+                    {pzX, pzY, pzZ, pzW}
+            };
+            std::copy(&planes[0][0], &planes[0][0] + 24, &mPlanes[0][0]);
         }
 
         [[nodiscard]] bool testAABB
@@ -83,5 +117,39 @@ namespace KCore {
                    pzY * (pzY < 0 ? minY : maxY) +
                    pzZ * (pzZ < 0 ? minZ : maxZ) >= -pzW;
         }
+
+        /** Three-state test against planes of planeMask only. On return planeMask keeps the
+         * planes that still straddle the box: boxes inside of it can skip all the others.
+         **/
+        [[nodiscard]] CullingState testAABB
+                (float minX, float minY, float minZ, float maxX, float maxY, float maxZ,
+                 uint8_t &planeMask) const {
+            uint8_t straddles = 0;
+
+            for (int p = 0; p < 6; p++) {
+                if (!(planeMask & (1 << p))) continue;
+
+                const auto &plane = mPlanes[p];
+                auto far = plane[0] * (plane[0] < 0 ? minX : maxX) +
+                           plane[1] * (plane[1] < 0 ? minY : maxY) +
+                           plane[2] * (plane[2] < 0 ? minZ : maxZ);
+                if (!(far >= -plane[3])) return Outside;
+
+                auto near = plane[0] * (plane[0] < 0 ? maxX : minX) +
+                            plane[1] * (plane[1] < 0 ? maxY : minY) +
+                            plane[2] * (plane[2] < 0 ? maxZ : minZ);
+                if (near < -plane[3]) straddles |= 1 << p;
+            }
+
+            planeMask = straddles;
+            return straddles ? Intersects : Inside;
+        }
+
+        /** Batch version of the three-state test: every box is tested against planes of planeMask.
+         * Writes OUTSIDE or mask of the planes box still straddles (0 is fully inside) per box.
+         * Uses AVX2 or SSE kernel when the CPU supports it, scalar loop otherwise.
+         **/
+        void testAABBBatch
+                (const AABBBatch &boxes, uint8_t planeMask, uint8_t *results) const;
     };
 }
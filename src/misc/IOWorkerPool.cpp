@@ -0,0 +1,139 @@
+#include "IOWorkerPool.hpp"
+
+#include <algorithm>
+
+namespace KCore {
+    IOWorkerPool::IOWorkerPool
+            (std::size_t threads, std::size_t queueCapacity) {
+        mTasks.resize(queueCapacity > 0 ? queueCapacity : 1);
+        startWorkers(threads);
+    }
+
+    IOWorkerPool::~IOWorkerPool() {
+        shutdown();
+    }
+
+    bool IOWorkerPool::submit
+            (Task task) {
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            if (mClosed || mCount == mTasks.size()) return false;
+
+            mTasks[(mHead + mCount) % mTasks.size()] = std::move(task);
+            mCount++;
+        }
+        mWakeUp.notify_one();
+
+        return true;
+    }
+
+    void IOWorkerPool::setThreadsCount
+            (std::size_t threads) {
+        if (threads == 0) threads = 1;
+
+        joinRetiredWorkers();
+
+        std::size_t started;
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            if (mClosed || threads == mTargetThreads) return;
+
+            mTargetThreads = threads;
+            started = threads > mLiveThreads ? threads - mLiveThreads : 0;
+        }
+
+        // idle surplus workers leave now, busy ones after their task
+        if (started == 0) {
+            mWakeUp.notify_all();
+            return;
+        }
+
+        startWorkers(started);
+    }
+
+    std::size_t IOWorkerPool::getThreadsCount() const {
+        std::lock_guard<std::mutex> lock{mLock};
+        return mTargetThreads;
+    }
+
+    void IOWorkerPool::shutdown() {
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            if (mClosed) return;
+            mClosed = true;
+        }
+
+        stopWorkers();
+
+        // cancelled tasks are released without running
+        for (auto &task: mTasks) task = nullptr;
+        mCount = 0;
+    }
+
+    void IOWorkerPool::startWorkers
+            (std::size_t threads) {
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            mLiveThreads += threads;
+            mTargetThreads = std::max(mTargetThreads, mLiveThreads);
+        }
+
+        for (std::size_t i = 0; i < threads; i++)
+            mWorkers.emplace_back([this]() { workerLoop(); });
+    }
+
+    void IOWorkerPool::stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            mStopping = true;
+        }
+        mWakeUp.notify_all();
+
+        for (auto &worker: mWorkers) worker.join();
+        mWorkers.clear();
+        mRetired.clear();
+    }
+
+    void IOWorkerPool::joinRetiredWorkers() {
+        std::vector<std::thread::id> retired;
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            retired.swap(mRetired);
+        }
+
+        // they are out of the loop already, join only waits for the thread to end
+        std::erase_if(mWorkers, [&retired](std::thread &worker) {
+            if (std::find(retired.begin(), retired.end(), worker.get_id()) == retired.end()) return false;
+
+            worker.join();
+            return true;
+        });
+    }
+
+    void IOWorkerPool::workerLoop() {
+        while (true) {
+            Task task;
+
+            {
+                std::unique_lock<std::mutex> lock{mLock};
+                mWakeUp.wait(lock, [this]() { return mStopping || mLiveThreads > mTargetThreads || mCount != 0; });
+                if (mStopping) return;
+
+                if (mLiveThreads > mTargetThreads) {
+                    mLiveThreads--;
+                    mRetired.push_back(std::this_thread::get_id());
+                    return;
+                }
+
+                task = std::move(mTasks[mHead]);
+                mHead = (mHead + 1) % mTasks.size();
+                mCount--;
+            }
+
+            // failed task is just a lost request, it must not take the worker down
+            try {
+                task();
+            } catch (const std::exception &) {}
+        }
+    }
+}
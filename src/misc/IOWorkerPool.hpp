@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "InlineFunction.hpp"
+
+namespace KCore {
+    /** Fixed set of threads for blocking work like network requests, fed from a bounded queue.
+     * submit() never waits: it refuses a task when the queue is full, so the caller may try again
+     * later. On shutdown running tasks are finished and queued ones are cancelled without running.
+     * Tasks are kept inline in the queue, so submit() doesn't allocate either.
+     **/
+    class IOWorkerPool {
+    public:
+        // enough for a request with its url and callback
+        constexpr static std::size_t TASK_CAPACITY = 640;
+
+        using Task = InlineFunction<void(), TASK_CAPACITY>;
+
+    private:
+        std::vector<std::thread> mWorkers;
+        // workers that have left the loop after shrinking, they are joined on the next resize
+        std::vector<std::thread::id> mRetired;
+        // surplus workers above target retire when they come for the next task
+        std::size_t mTargetThreads{0}, mLiveThreads{0};
+
+        mutable std::mutex mLock;
+        std::condition_variable mWakeUp;
+
+        // ring of queued tasks
+        std::vector<Task> mTasks;
+        std::size_t mHead{0}, mCount{0};
+
+        // workers leave on stopping, queue refuses tasks once closed
+        bool mStopping{false}, mClosed{false};
+
+    public:
+        IOWorkerPool
+                (std::size_t threads, std::size_t queueCapacity);
+
+        ~IOWorkerPool();
+
+        IOWorkerPool(const IOWorkerPool &) = delete;
+
+        IOWorkerPool &operator=(const IOWorkerPool &) = delete;
+
+        // false if queue is full or pool is shut down
+        bool submit
+                (Task task);
+
+        // never waits for running tasks: workers above the new count finish them and leave
+        void setThreadsCount
+                (std::size_t threads);
+
+        [[nodiscard]] std::size_t getThreadsCount() const;
+
+        // waits for running tasks, cancels queued ones
+        void shutdown();
+
+    private:
+        void startWorkers
+                (std::size_t threads);
+
+        void stopWorkers();
+
+        void joinRetiredWorkers();
+
+        void workerLoop();
+    };
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace KCore {
+    template<typename Signature, std::size_t Capacity>
+    class InlineFunction;
+
+    /** Move-only callable kept in a buffer of fixed capacity, it never allocates.
+     * Used instead of std::function where callables are made every frame, callable that
+     * doesn't fit is a compile error. Moved-from function is empty, moves are noexcept,
+     * so callable that throws on move terminates
+     **/
+    template<typename R, typename... Args, std::size_t Capacity>
+    class InlineFunction<R(Args...), Capacity> {
+    private:
+        alignas(std::max_align_t) mutable unsigned char mStorage[Capacity];
+
+        R (*mInvoke)(void *, Args...){nullptr};
+        // moves callable from source into destination, or only destroys it when destination is null
+        void (*mRelocate)(void *, void *){nullptr};
+
+    public:
+        InlineFunction() = default;
+
+        InlineFunction
+                (std::nullptr_t) {}
+
+        template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+        InlineFunction
+                (F &&function) {
+            using Callable = std::decay_t<F>;
+            static_assert(sizeof(Callable) <= Capacity, "callable doesn't fit into the inline function");
+            static_assert(alignof(Callable) <= alignof(std::max_align_t), "callable is overaligned");
+
+            new(mStorage) Callable(std::forward<F>(function));
+
+            mInvoke = [](void *callable, Args... args) -> R {
+                return (*(Callable *) callable)(std::forward<Args>(args)...);
+            };
+            mRelocate = [](void *destination, void *source) {
+                if (destination != nullptr) new(destination) Callable(std::move(*(Callable *) source));
+                ((Callable *) source)->~Callable();
+            };
+        }
+
+        InlineFunction
+                (InlineFunction &&other) noexcept {
+            takeFrom(other);
+        }
+
+        InlineFunction &operator=(InlineFunction &&other) noexcept {
+            if (this != &other) {
+                reset();
+                takeFrom(other);
+            }
+            return *this;
+        }
+
+        InlineFunction &operator=(std::nullptr_t) noexcept {
+            reset();
+            return *this;
+        }
+
+        InlineFunction(const InlineFunction &) = delete;
+
+        InlineFunction &operator=(const InlineFunction &) = delete;
+
+        ~InlineFunction() {
+            reset();
+        }
+
+        R operator()(Args... args) const {
+            return mInvoke(mStorage, std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const {
+            return mInvoke != nullptr;
+        }
+
+    private:
+        void reset() {
+            if (mRelocate != nullptr) mRelocate(nullptr, mStorage);
+            mInvoke = nullptr;
+            mRelocate = nullptr;
+        }
+
+        void takeFrom
+                (InlineFunction &other) {
+            if (other.mRelocate == nullptr) return;
+
+            other.mRelocate(mStorage, other.mStorage);
+            mInvoke = other.mInvoke;
+            mRelocate = other.mRelocate;
+            other.mInvoke = nullptr;
+            other.mRelocate = nullptr;
+        }
+    };
+}
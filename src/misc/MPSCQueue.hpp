@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace KCore {
+    /** Bounded lock-free queue for many producers and a single consumer.
+     * Every slot carries a sequence number: producers claim a position with one CAS
+     * and publish the slot by bumping its sequence, the consumer takes published slots
+     * in order and hands them back a lap later. Neither side ever waits on a lock;
+     * a push into a full queue fails and the producer decides what to do with it.
+     **/
+    template<typename T, std::size_t Capacity>
+    class MPSCQueue {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be power of two");
+
+    private:
+        constexpr static std::size_t MASK = Capacity - 1;
+
+        struct Slot {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Slot[]> mSlots{new Slot[Capacity]};
+
+        // producers and consumer positions live on separate cache lines
+        alignas(64) std::atomic<std::size_t> mTail{0};
+        alignas(64) std::size_t mHead{0};
+
+    public:
+        MPSCQueue() {
+            for (std::size_t i = 0; i < Capacity; i++)
+                mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MPSCQueue(const MPSCQueue &) = delete;
+
+        MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+        // any thread
+        bool tryPush
+                (const T &value) {
+            auto position = mTail.load(std::memory_order_relaxed);
+
+            while (true) {
+                auto &slot = mSlots[position & MASK];
+                auto sequence = slot.sequence.load(std::memory_order_acquire);
+                auto difference = (std::intptr_t) sequence - (std::intptr_t) position;
+
+                if (difference == 0) {
+                    if (mTail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        slot.value = value;
+                        slot.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    // consumer hasn't freed this slot yet
+                    return false;
+                } else {
+                    position = mTail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // consumer thread only
+        bool tryPop
+                (T &value) {
+            auto &slot = mSlots[mHead & MASK];
+            auto sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence != mHead + 1) return false;
+
+            value = std::move(slot.value);
+            slot.sequence.store(mHead + Capacity, std::memory_order_release);
+            mHead++;
+            return true;
+        }
+
+        // consumer thread only, moves up to capacity items into out, returns their count
+        std::size_t pop
+                (T *out, std::size_t capacity) {
+            std::size_t count = 0;
+            while (count < capacity && tryPop(out[count])) count++;
+            return count;
+        }
+
+        // approximate when producers are active
+        [[nodiscard]] std::size_t size() const {
+            auto tail = mTail.load(std::memory_order_acquire);
+            return tail >= mHead ? tail - mHead : 0;
+        }
+
+        [[nodiscard]] constexpr static std::size_t capacity() {
+            return Capacity;
+        }
+    };
+}
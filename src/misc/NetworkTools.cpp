@@ -1,14 +1,18 @@
 #include "NetworkTools.hpp"
 
-#include <thread>
 #include <iostream>
 
 #include "HTTPRequest.hpp"
 
+#include "IOWorkerPool.hpp"
+
 namespace KCore {
     void NetworkTools::performGETRequestAsync
             (const std::string &url, const std::function<void(const std::vector<uint8_t> &)> &callback) {
-        std::thread{[url, callback]() {
+        // shared by all callers instead of a thread per request
+        static IOWorkerPool pool{2, 64};
+
+        auto submitted = pool.submit([url, callback]() {
             try {
                 http::Request request{url};
                 const auto response = request.send("GET", "", {
@@ -21,7 +25,10 @@ namespace KCore {
             } catch (const std::exception &e) {
                 std::cerr << "Request failed, error: " << e.what() << '\n';
             }
-        }}.detach();
+        });
+
+        if (!submitted)
+            std::cerr << "Request failed, error: too many requests in flight\n";
     }
 
     std::vector<uint8_t> NetworkTools::performGETRequestSync
@@ -0,0 +1,78 @@
+#include "PixelBufferPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace KCore {
+    std::mutex PixelBufferPool::sLock{};
+    std::array<std::vector<uint8_t *>, PixelBufferPool::MAX_CLASS_SHIFT - PixelBufferPool::MIN_CLASS_SHIFT + 1>
+            PixelBufferPool::sFree{};
+
+    int PixelBufferPool::sizeClass
+            (std::size_t size) {
+        int shift = MIN_CLASS_SHIFT;
+        while (shift <= MAX_CLASS_SHIFT && (std::size_t{1} << shift) < size) shift++;
+        return shift <= MAX_CLASS_SHIFT ? shift - MIN_CLASS_SHIFT : -1;
+    }
+
+    std::size_t &PixelBufferPool::capacityOf
+            (uint8_t *buffer) {
+        return *(std::size_t *) (buffer - HEADER_SIZE);
+    }
+
+    uint8_t *PixelBufferPool::acquire
+            (std::size_t size) {
+        auto index = sizeClass(size);
+
+        if (index >= 0) {
+            std::lock_guard<std::mutex> lock{sLock};
+
+            auto &free = sFree[index];
+            if (!free.empty()) {
+                auto *buffer = free.back();
+                free.pop_back();
+                return buffer;
+            }
+        }
+
+        auto capacity = index >= 0 ? std::size_t{1} << (index + MIN_CLASS_SHIFT) : size;
+        auto *buffer = new uint8_t[HEADER_SIZE + capacity] + HEADER_SIZE;
+        capacityOf(buffer) = capacity;
+        return buffer;
+    }
+
+    uint8_t *PixelBufferPool::reallocate
+            (uint8_t *buffer, std::size_t size) {
+        if (buffer == nullptr) return acquire(size);
+
+        auto capacity = capacityOf(buffer);
+        if (capacity >= size) return buffer;
+
+        auto *grown = acquire(size);
+        std::memcpy(grown, buffer, capacity);
+        release(buffer);
+        return grown;
+    }
+
+    void PixelBufferPool::release
+            (uint8_t *buffer) {
+        if (buffer == nullptr) return;
+
+        // oversized capacities never match a class
+        auto capacity = capacityOf(buffer);
+        auto index = sizeClass(capacity);
+
+        if (index >= 0) {
+            std::lock_guard<std::mutex> lock{sLock};
+
+            auto &free = sFree[index];
+            auto limit = std::max<std::size_t>(POOLED_BYTES_PER_CLASS >> (index + MIN_CLASS_SHIFT), 1);
+            if (free.size() < limit) {
+                free.push_back(buffer);
+                return;
+            }
+        }
+
+        delete[] (buffer - HEADER_SIZE);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace KCore {
+    /** Recycles pixel buffers by power of two size classes, so steady streaming of same sized
+     * rasters doesn't hit the allocator. Every buffer remembers its capacity in a small header,
+     * which lets it serve as malloc/realloc/free for the image decoder: decoded pixels are
+     * written straight into a pooled buffer and the same buffer goes to the host.
+     * Each class keeps a bounded amount of memory, oversized buffers aren't pooled at all.
+     **/
+    class PixelBufferPool {
+    private:
+        constexpr static std::size_t HEADER_SIZE = 16;
+        constexpr static int MIN_CLASS_SHIFT = 12;
+        constexpr static int MAX_CLASS_SHIFT = 24;
+        constexpr static std::size_t POOLED_BYTES_PER_CLASS = std::size_t{8} << 20;
+
+        static std::mutex sLock;
+        static std::array<std::vector<uint8_t *>, MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1> sFree;
+
+    public:
+        static uint8_t *acquire
+                (std::size_t size);
+
+        // keeps contents, like realloc
+        static uint8_t *reallocate
+                (uint8_t *buffer, std::size_t size);
+
+        static void release
+                (uint8_t *buffer);
+
+    private:
+        // index of size class or -1 for oversized buffers
+        static int sizeClass
+                (std::size_t size);
+
+        static std::size_t &capacityOf
+                (uint8_t *buffer);
+    };
+}
@@ -0,0 +1,35 @@
+#include "STBImageUtils.hpp"
+
+#include <stdexcept>
+
+#include "PixelBufferPool.hpp"
+
+// the decoder is compiled here only, the rest of the tree sees just the helpers
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_STATIC
+
+// decoder allocates from pixel pool, so its output may be handed over without copy
+#define STBI_MALLOC(size) ((void *) KCore::PixelBufferPool::acquire(size))
+#define STBI_REALLOC(buffer, size) ((void *) KCore::PixelBufferPool::reallocate((uint8_t *) (buffer), size))
+#define STBI_FREE(buffer) KCore::PixelBufferPool::release((uint8_t *) (buffer))
+
+#include <stb_image.h>
+
+namespace KCore::STBImageUtils {
+    uint8_t *decodeImageBuffer
+            (const void *buffer, const std::size_t &length, int &width, int &height, int &channels) {
+        unsigned char *data = stbi_load_from_memory
+                ((const stbi_uc *) buffer, (int) length, &width, &height, &channels, STBI_default);
+        if (data == nullptr || width * height < 0 || channels <= 0) {
+            stbi_image_free(data);
+            throw std::runtime_error("can't decode image");
+        }
+
+        return data;
+    }
+
+    void releaseImageBuffer
+            (uint8_t *data) {
+        stbi_image_free(data);
+    }
+}
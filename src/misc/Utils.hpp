@@ -1,7 +1,6 @@
 #pragma once
 
 #include <cstdint>
-#include <map>
 #include <vector>
 
 static std::vector<uint8_t> anythingToByteVector
@@ -11,39 +10,3 @@ static std::vector<uint8_t> anythingToByteVector
     convertedVtxPosData.assign(begin_ptr, begin_ptr + (length * elementSize));
     return convertedVtxPosData;
 }
-
-template<typename F, typename S>
-static std::vector<F> mapKeysDifference
-        (const std::map<F, S> &fMap, const std::map<F, S> &sMap) {
-    auto result = std::vector<F>{};
-
-    auto collector = std::map<F, uint8_t>{};
-    for (const auto &[key, _]: fMap) collector[key] = 0;
-    for (const auto &[key, _]: sMap) collector[key] = 0;
-
-    for (const auto &[key, _]: fMap) collector[key]++;
-    for (const auto &[key, _]: sMap) collector[key]++;
-
-    for (const auto &[key, _]: collector)
-        if (collector[key] == 1) result.push_back(key);
-
-    return result;
-}
-
-template<typename F, typename S>
-static std::vector<F> mapKeysIntersection
-        (const std::map<F, S> &fMap, const std::map<F, S> &sMap) {
-    auto result = std::vector<F>{};
-
-    auto collector = std::map<F, uint8_t>{};
-    for (const auto &[key, _]: fMap) collector[key] = 0;
-    for (const auto &[key, _]: sMap) collector[key] = 0;
-
-    for (const auto &[key, _]: fMap) collector[key]++;
-    for (const auto &[key, _]: sMap) collector[key]++;
-
-    for (const auto &[key, _]: collector)
-        if (collector[key] == 2) result.push_back(key);
-
-    return result;
-}
\ No newline at end of file
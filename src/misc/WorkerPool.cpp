@@ -0,0 +1,90 @@
+#include "WorkerPool.hpp"
+
+namespace KCore {
+    WorkerPool::WorkerPool
+            (std::size_t threads) {
+        if (threads == 0) {
+            auto hardware = std::thread::hardware_concurrency();
+            threads = hardware > 1 ? hardware - 1 : 0;
+        }
+
+        mWorkers.reserve(threads);
+        for (std::size_t i = 0; i < threads; i++)
+            mWorkers.emplace_back([this]() { workerLoop(); });
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            mStopping = true;
+        }
+        mWakeUp.notify_all();
+
+        for (auto &worker: mWorkers) worker.join();
+    }
+
+    void WorkerPool::run
+            (std::size_t count, const std::function<void(std::size_t)> &job) {
+        if (count == 0) return;
+
+        // nothing to share: avoid waking workers for a single job
+        if (mWorkers.empty() || count == 1) {
+            for (std::size_t i = 0; i < count; i++) job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{mLock};
+            mJob = &job;
+            mJobsCount = count;
+            mJobsDone = 0;
+            mNextJob.store(0, std::memory_order_relaxed);
+            mGeneration++;
+        }
+        mWakeUp.notify_all();
+
+        auto done = drainJobs();
+
+        std::unique_lock<std::mutex> lock{mLock};
+        mJobsDone += done;
+        // batch state is reset by the next run(), so wait for stragglers that found no job too
+        mFinished.wait(lock, [this]() { return mJobsDone == mJobsCount && mActiveWorkers == 0; });
+        mJob = nullptr;
+    }
+
+    std::size_t WorkerPool::getThreadsCount() const {
+        return mWorkers.size();
+    }
+
+    void WorkerPool::workerLoop() {
+        std::uint64_t seenGeneration = 0;
+
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock{mLock};
+                mWakeUp.wait(lock, [&]() { return mStopping || (mJob && mGeneration != seenGeneration); });
+                if (mStopping) return;
+                seenGeneration = mGeneration;
+                mActiveWorkers++;
+            }
+
+            auto done = drainJobs();
+
+            std::lock_guard<std::mutex> lock{mLock};
+            mJobsDone += done;
+            mActiveWorkers--;
+            if (mJobsDone == mJobsCount && mActiveWorkers == 0) mFinished.notify_one();
+        }
+    }
+
+    std::size_t WorkerPool::drainJobs() {
+        std::size_t done = 0;
+        while (true) {
+            auto index = mNextJob.fetch_add(1, std::memory_order_relaxed);
+            if (index >= mJobsCount) return done;
+
+            (*mJob)(index);
+            done++;
+        }
+    }
+}
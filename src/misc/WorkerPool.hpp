@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace KCore {
+    /** Fixed set of threads created once and parked between jobs.
+     * run() hands out job indices [0, count) to workers and the calling thread
+     * and blocks until every job is done, so no threads are created per call.
+     **/
+    class WorkerPool {
+    private:
+        std::vector<std::thread> mWorkers;
+
+        std::mutex mLock;
+        std::condition_variable mWakeUp, mFinished;
+
+        // current batch, the generation tells parked workers that a new one arrived
+        const std::function<void(std::size_t)> *mJob{nullptr};
+        std::size_t mJobsCount{0};
+        std::atomic<std::size_t> mNextJob{0};
+        std::size_t mJobsDone{0}, mActiveWorkers{0};
+        std::uint64_t mGeneration{0};
+        bool mStopping{false};
+
+    public:
+        // zero means one worker per hardware thread (besides the caller)
+        explicit WorkerPool
+                (std::size_t threads = 0);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        void run
+                (std::size_t count, const std::function<void(std::size_t)> &job);
+
+        [[nodiscard]] std::size_t getThreadsCount() const;
+
+    private:
+        void workerLoop();
+
+        // takes jobs until none are left, returns the number of completed ones
+        std::size_t drainJobs();
+    };
+}
@@ -3,22 +3,23 @@
 #include <iostream>
 
 namespace KCore {
-    std::vector<uint8_t> HTTPRequestNetworkAdapter::SyncRequest
+    ByteBuffer HTTPRequestNetworkAdapter::SyncRequest
             (const std::string &url, const std::string &method) {
-        auto result = getFromCache(url);
-        if (result.has_value())
-            return {result->begin(), result->end()};
+        auto cached = getFromCache(url);
+        if (cached != nullptr)
+            return cached;
 
         http::Request request{url};
-        const auto response = request.send("GET", "", {
+        auto response = request.send(method, "", {
                 {"Content-Type", "application/x-www-form-urlencoded"},
                 {"User-Agent",   mUserAgent},
         });
 
         if (response.status.code == http::Status::Ok) {
-            result = {response.body.begin(), response.body.end()};
-            insertToCache(url, result.value());
-            return result.value();
+            // body is moved into shared buffer once and never copied after
+            auto result = std::make_shared<const std::vector<uint8_t>>(std::move(response.body));
+            insertToCache(url, result);
+            return result;
         }
 
         throw std::runtime_error(response.status.reason);
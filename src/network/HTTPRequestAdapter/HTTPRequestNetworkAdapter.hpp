@@ -9,7 +9,11 @@
 namespace KCore {
     class HTTPRequestNetworkAdapter : public INetworkAdapter {
     public:
-        std::vector<uint8_t> SyncRequest
+        ~HTTPRequestNetworkAdapter() override {
+            shutdown();
+        }
+
+        ByteBuffer SyncRequest
                 (const std::string &url, const std::string &method) override;
     };
 }
\ No newline at end of file
@@ -1,63 +1,164 @@
 #pragma once
 
-#include <functional>
+#include <atomic>
+#include <memory>
 #include <mutex>
-#include <optional>
 #include <string>
-#include <thread>
+#include <vector>
 
 #include "LRUCache17.hpp"
 
+#include "../misc/InlineFunction.hpp"
+#include "../misc/IOWorkerPool.hpp"
+#include "RequestHandlePool.hpp"
+#include "RequestUrl.hpp"
+
 namespace KCore {
+    // response body shared by network cache, callbacks and decoder without copies
+    using ByteBuffer = std::shared_ptr<const std::vector<std::uint8_t>>;
+
+    // cancelled request isn't downloaded if it's still queued and doesn't call back if it's in flight
+    class NetworkRequest {
+    private:
+        std::atomic<bool> mCancelled{false};
+
+    public:
+        void cancel() {
+            mCancelled.store(true, std::memory_order_release);
+        }
+
+        [[nodiscard]] bool isCancelled() const {
+            return mCancelled.load(std::memory_order_acquire);
+        }
+    };
+
+    using RequestHandle = std::shared_ptr<NetworkRequest>;
+
+    // handle of every visible tile comes from the pool, not the heap
+    inline RequestHandle makeRequestHandle() {
+        return std::allocate_shared<NetworkRequest>(RequestHandlePool::Allocator<NetworkRequest>{});
+    }
+
+    // callback of a request is made every frame too, it has to fit the handle and a tile
+    using RequestCallback = InlineFunction<void(const ByteBuffer &), 48>;
+
     class INetworkAdapter {
     private:
-        lru17::Cache <std::string, std::vector<std::uint8_t>> mNetworkCache{2 << 7, 2 << 4};
+        lru17::Cache <std::string, ByteBuffer> mNetworkCache{2 << 7, 2 << 4};
         std::mutex mNetworkCacheMutex;
 
+        constexpr static int MAX_PREFETCHES_IN_FLIGHT = 4;
+        std::atomic<int> mPrefetchesInFlight{0};
+
+        constexpr static std::size_t DEFAULT_REQUEST_THREADS = 4;
+        constexpr static std::size_t REQUESTS_QUEUE_CAPACITY = 256;
+
+        // all requests run here instead of a thread per request
+        IOWorkerPool mRequestsPool{DEFAULT_REQUEST_THREADS, REQUESTS_QUEUE_CAPACITY};
+
     protected:
         const char *mUserAgent = "KarafutoMapCore/0.1";
 
     protected:
         void insertToCache
-                (const std::string &key, const std::vector<std::uint8_t> &val) {
+                (const std::string &key, const ByteBuffer &val) {
             std::lock_guard<std::mutex> lock{mNetworkCacheMutex};
 
             mNetworkCache.insert(key, val);
         }
 
-        std::optional<std::vector<std::uint8_t>> getFromCache
+        // nullptr on miss
+        ByteBuffer getFromCache
                 (const std::string &key) {
             std::lock_guard<std::mutex> lock{mNetworkCacheMutex};
 
             if (mNetworkCache.contains(key))
                 return mNetworkCache.get(key);
             else
-                return std::nullopt;
+                return nullptr;
+        }
+
+        bool isCached
+                (const std::string &key) {
+            std::lock_guard<std::mutex> lock{mNetworkCacheMutex};
+
+            return mNetworkCache.contains(key);
         }
 
     public:
         INetworkAdapter() = default;
 
-        void AsyncGETRequest
-                (const std::string &url, const std::function<void(const std::vector<uint8_t> &)> &callback) {
-            AsyncRequest(url, "GET", callback);
+        // derived adapters should call shutdown() in their own destructors, running requests use them
+        virtual ~INetworkAdapter() {
+            shutdown();
+        }
+
+        // waits for running requests and cancels queued ones, their callbacks are never called after it
+        void shutdown() {
+            mRequestsPool.shutdown();
+        }
+
+        void setRequestThreads
+                (std::size_t threads) {
+            mRequestsPool.setThreadsCount(threads);
+        }
+
+        // low priority download into cache only. Returns false if there are too many of them
+        // in flight already, so the caller may try again later
+        bool AsyncPrefetch
+                (const RequestUrl &url) {
+            if (mPrefetchesInFlight.fetch_add(1) >= MAX_PREFETCHES_IN_FLIGHT) {
+                mPrefetchesInFlight--;
+                return false;
+            }
+
+            auto submitted = mRequestsPool.submit([this, url]() {
+                // nobody waits for it, failed prefetch is just a cache miss later
+                try {
+                    auto key = url.str();
+                    if (!isCached(key)) SyncRequest(key, "GET");
+                } catch (const std::exception &) {}
+
+                mPrefetchesInFlight--;
+            });
+
+            if (!submitted) mPrefetchesInFlight--;
+            return submitted;
+        }
+
+        // returns handle to cancel the request or nullptr if requests queue is full, so the caller
+        // may try again later. Handle may be made by the caller when the callback has to know it
+        RequestHandle AsyncGETRequest
+                (const RequestUrl &url, RequestCallback callback, RequestHandle handle = nullptr) {
+            return AsyncRequest(url, "GET", std::move(callback), std::move(handle));
         }
 
-        std::vector<uint8_t> SyncGETRequest
-                (const std::string &url, const std::string &method) {
+        ByteBuffer SyncGETRequest
+                (const std::string &url) {
             return SyncRequest(url, "GET");
         }
 
-        void AsyncRequest
-                (const std::string &url, const std::string &method,
-                 const std::function<void(const std::vector<uint8_t> &)> &callback) {
-            std::thread{[this, url, method, callback]() {
-                auto result = SyncRequest(url, method);
-                callback(result);
-            }}.detach();
+        // method is kept as a pointer until the request runs, it has to be a string literal
+        RequestHandle AsyncRequest
+                (const RequestUrl &url, const char *method, RequestCallback callback,
+                 RequestHandle handle = nullptr) {
+            if (handle == nullptr) handle = makeRequestHandle();
+
+            auto submitted = mRequestsPool.submit(
+                    [this, url, method, callback = std::move(callback), handle]() {
+                        if (handle->isCancelled()) return;
+
+                        auto result = SyncRequest(url.str(), method);
+
+                        // response of cancelled request stays in cache only
+                        if (handle->isCancelled()) return;
+                        callback(result);
+                    });
+
+            return submitted ? handle : nullptr;
         }
 
-        virtual std::vector<uint8_t> SyncRequest
+        virtual ByteBuffer SyncRequest
                 (const std::string &url, const std::string &method) = 0;
     };
 }
\ No newline at end of file
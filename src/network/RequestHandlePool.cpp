@@ -0,0 +1,40 @@
+#include "RequestHandlePool.hpp"
+
+namespace KCore {
+    std::mutex RequestHandlePool::sLock{};
+    std::vector<std::unique_ptr<RequestHandlePool::Block[]>> RequestHandlePool::sChunks{};
+    std::size_t RequestHandlePool::sChunkUsed{RequestHandlePool::CHUNK_BLOCKS};
+    std::vector<RequestHandlePool::Block *> RequestHandlePool::sFree{};
+
+    void *RequestHandlePool::acquire() {
+        std::lock_guard<std::mutex> lock{sLock};
+
+        if (!sFree.empty()) {
+            auto *block = sFree.back();
+            sFree.pop_back();
+            return block;
+        }
+
+        if (sChunkUsed == CHUNK_BLOCKS) {
+            sChunks.push_back(std::make_unique<Block[]>(CHUNK_BLOCKS));
+            // every block may end up in free list at once, so it never has to grow on release
+            sFree.reserve(sChunks.size() * CHUNK_BLOCKS);
+            sChunkUsed = 0;
+        }
+
+        return &sChunks.back()[sChunkUsed++];
+    }
+
+    void RequestHandlePool::release
+            (void *block) {
+        std::lock_guard<std::mutex> lock{sLock};
+
+        sFree.push_back((Block *) block);
+    }
+
+    std::size_t RequestHandlePool::getCapacity() {
+        std::lock_guard<std::mutex> lock{sLock};
+
+        return sChunks.size() * CHUNK_BLOCKS;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace KCore {
+    /** Storage of request handles together with their shared counters.
+     * Every visible tile makes a handle, so they come in fixed blocks from chunks that are
+     * never freed and go back to a free list. The last reference may be dropped on any
+     * thread, the free list has room for every block, so release never allocates.
+     **/
+    class RequestHandlePool {
+    private:
+        constexpr static std::size_t BLOCK_SIZE = 64;
+        constexpr static std::size_t CHUNK_BLOCKS = 256;
+
+        struct alignas(std::max_align_t) Block {
+            unsigned char bytes[BLOCK_SIZE];
+        };
+
+        static std::mutex sLock;
+        static std::vector<std::unique_ptr<Block[]>> sChunks;
+        static std::size_t sChunkUsed;
+        static std::vector<Block *> sFree;
+
+    public:
+        // allocator for std::allocate_shared, the handle and its counters take one block
+        template<typename T>
+        struct Allocator {
+            using value_type = T;
+
+            Allocator() = default;
+
+            template<typename U>
+            Allocator
+                    (const Allocator<U> &) {}
+
+            T *allocate
+                    (std::size_t count) {
+                static_assert(sizeof(T) <= BLOCK_SIZE, "request handle doesn't fit into pool block");
+                static_assert(alignof(T) <= alignof(Block), "request handle is overaligned");
+
+                if (count != 1) return (T *) ::operator new(count * sizeof(T));
+                return (T *) acquire();
+            }
+
+            void deallocate
+                    (T *ptr, std::size_t count) {
+                if (count != 1) ::operator delete(ptr);
+                else release(ptr);
+            }
+
+            template<typename U>
+            bool operator==(const Allocator<U> &) const {
+                return true;
+            }
+        };
+
+        static void *acquire();
+
+        static void release
+                (void *block);
+
+        [[nodiscard]] static std::size_t getCapacity();
+    };
+}
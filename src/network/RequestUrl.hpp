@@ -0,0 +1,47 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace KCore {
+    /** Url written into a buffer of fixed capacity, so it's baked every frame and handed
+     * to the network threads without allocations. Parts beyond the capacity are cut off,
+     * sources that may produce longer urls are refused before that
+     **/
+    class RequestUrl {
+    public:
+        constexpr static std::size_t CAPACITY = 512;
+
+    private:
+        std::array<char, CAPACITY> mData{};
+        std::size_t mLength{0};
+
+    public:
+        RequestUrl() = default;
+
+        explicit RequestUrl
+                (std::string_view url) {
+            append(url);
+        }
+
+        RequestUrl &append
+                (std::string_view part) {
+            auto length = std::min(part.size(), CAPACITY - mLength);
+            std::copy_n(part.data(), length, mData.data() + mLength);
+            mLength += length;
+            return *this;
+        }
+
+        [[nodiscard]] std::string_view view() const {
+            return {mData.data(), mLength};
+        }
+
+        // adapters and their caches take strings, it's made on the network thread
+        [[nodiscard]] std::string str() const {
+            return std::string{view()};
+        }
+    };
+}
@@ -3,8 +3,10 @@
 #include "misc/DebugNewtorkResources.inl"
 
 namespace KCore {
-    std::vector<uint8_t> DebugNetworkAdapter::SyncRequest
-            (const std::string &url, const std::string &method) {
-        return KCore::Network::Debug::Resource::image;
+    ByteBuffer DebugNetworkAdapter::SyncRequest
+            (const std::string &, const std::string &) {
+        static const ByteBuffer image = std::make_shared<const std::vector<uint8_t>>
+                (KCore::Network::Debug::Resource::image);
+        return image;
     }
 }
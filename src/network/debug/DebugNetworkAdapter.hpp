@@ -5,7 +5,11 @@
 namespace KCore {
     class DebugNetworkAdapter : public INetworkAdapter {
     public:
-        std::vector<uint8_t> SyncRequest
+        ~DebugNetworkAdapter() override {
+            shutdown();
+        }
+
+        ByteBuffer SyncRequest
                 (const std::string &url, const std::string &method) override;
     };
 }
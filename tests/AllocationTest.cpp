@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "layer/LayerInterface.hpp"
+
+/** Counts heap allocations made by the calling thread inside LayerInterface::calculate().
+ * Once the node pool, request pools and frame buffers have grown, a frame doesn't allocate,
+ * no matter how many tiles come into view: request handles are pooled, urls, callbacks and
+ * network tasks are kept inline. Network and delivery threads aren't counted, their
+ * allocations don't stall the frame
+ **/
+
+namespace {
+    constexpr long MAX_ALLOCATIONS_PER_FRAME = 0;
+
+    constexpr int PATH_FRAMES = 40;
+    constexpr int WARMUP_PATHS = 2;
+    constexpr int CHECKED_PATHS = 5;
+    constexpr int STILL_FRAMES = 200;
+
+    thread_local bool tCounting = false;
+    long gAllocations = 0;
+}
+
+void *operator new(std::size_t size) {
+    if (tCounting) gAllocations++;
+    if (auto *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+using namespace KCore;
+
+static long calculateCounted
+        (LayerInterface &layer, float x) {
+    float position[3] = {x, 2.0f, 10.0f}, rotation[3] = {-0.6f, 0.0f, 0.0f};
+    layer.updateViewMatrixFromParams(position, rotation);
+
+    gAllocations = 0;
+    tCounting = true;
+    layer.calculate();
+    tCounting = false;
+
+    return gAllocations;
+}
+
+static long drainAddedTiles
+        (LayerInterface &layer) {
+    long added = 0;
+    for (const auto &event: layer.getCoreEvents())
+        added += event.type == InFrustum;
+
+    // images are dropped, pixels go back to the pool
+    layer.getImageEvents();
+    return added;
+}
+
+int main() {
+    LayerInterface layer{46.95f, 142.73f};
+    layer.updateProjectionMatrixFromParams(glm::radians(60.0f), 16.0f / 9.0f, 0.01f, 10000.0f);
+
+    // nothing listens there, requests fail fast and are counted all the same
+    layer.raw()->setRasterUrl("http://127.0.0.1:9/{z}/{x}/{y}.png");
+
+    // camera pans forth and back, so tiles keep coming into view and leaving it
+    auto pathPosition = [](int frame) {
+        auto step = frame % PATH_FRAMES;
+        return (float) (step < PATH_FRAMES / 2 ? step : PATH_FRAMES - step) * 0.1f;
+    };
+
+    for (int frame = 0; frame < PATH_FRAMES * WARMUP_PATHS; frame++) {
+        calculateCounted(layer, pathPosition(frame));
+        drainAddedTiles(layer);
+    }
+
+    int failures = 0;
+    long worstFrame = 0, added = 0;
+    for (int frame = 0; frame < PATH_FRAMES * CHECKED_PATHS; frame++) {
+        auto allocations = calculateCounted(layer, pathPosition(frame));
+        added += drainAddedTiles(layer);
+
+        worstFrame = std::max(worstFrame, allocations);
+        if (allocations > MAX_ALLOCATIONS_PER_FRAME) {
+            std::printf("moving frame %d: %ld allocations, expected at most %ld\n",
+                        frame, allocations, MAX_ALLOCATIONS_PER_FRAME);
+            failures++;
+        }
+    }
+
+    // still camera doesn't allocate at all once the last requests are out
+    long stillAllocations = 0;
+    for (int frame = 0; frame < STILL_FRAMES; frame++) {
+        auto allocations = calculateCounted(layer, pathPosition(0));
+        drainAddedTiles(layer);
+
+        if (layer.getStats().requestsPending == 0 && layer.getStats().requestsStarted == 0)
+            stillAllocations += allocations;
+    }
+
+    if (stillAllocations != 0) {
+        std::printf("still camera: %ld allocations, expected none\n", stillAllocations);
+        failures++;
+    }
+
+    std::printf("tiles added: %ld, worst moving frame: %ld allocations, still camera: %ld\n",
+                added, worstFrame, stillAllocations);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}